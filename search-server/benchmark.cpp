@@ -0,0 +1,684 @@
+#include "benchmark.h"
+#include "search_server.h"
+#include "process_queries.h"
+#include "instrumentation.h"
+#include "corpus_loader.h"
+#include "concurrent_map.h"
+#include "replicated_search_server.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+
+ZipfDistribution::ZipfDistribution(size_t size, double exponent)
+	: cumulative_(size)
+{
+	double sum = 0.0;
+	for (size_t rank = 0; rank < size; ++rank)
+	{
+		sum += 1.0 / std::pow(static_cast<double>(rank + 1), exponent);
+		cumulative_[rank] = sum;
+	}
+	for (double& value : cumulative_)
+	{
+		value /= sum;
+	}
+}
+
+size_t ZipfDistribution::operator()(std::mt19937_64& generator) const
+{
+	const double point = std::uniform_real_distribution<double>(0.0, 1.0)(generator);
+	const auto it = std::lower_bound(cumulative_.begin(), cumulative_.end(), point);
+	return std::min(static_cast<size_t>(it - cumulative_.begin()), cumulative_.size() - 1);
+}
+
+SyntheticCorpus::SyntheticCorpus(const BenchmarkConfig& config)
+	: config_(config), words_(config.vocabulary_size, config.zipf_exponent), generator_(config.seed)
+{
+}
+
+std::string SyntheticCorpus::MakeWord(size_t rank)
+{
+	std::string word;
+	do
+	{
+		word.push_back(static_cast<char>('a' + rank % 26));
+		rank /= 26;
+	} while (rank != 0);
+	return word;
+}
+
+std::string SyntheticCorpus::GenerateDocument()
+{
+	std::string document;
+	for (size_t i = 0; i < config_.document_length; ++i)
+	{
+		if (i != 0)
+		{
+			document.push_back(' ');
+		}
+		document += MakeWord(words_(generator_));
+	}
+	return document;
+}
+
+std::string SyntheticCorpus::GenerateQuery()
+{
+	std::string query;
+	for (size_t i = 0; i < config_.query_length; ++i)
+	{
+		if (i != 0)
+		{
+			query.push_back(' ');
+		}
+		query += MakeWord(words_(generator_));
+	}
+	if (std::uniform_int_distribution<int>(0, 3)(generator_) == 0)
+	{
+		query += " -" + MakeWord(words_(generator_));
+	}
+	return query;
+}
+
+//the whole value has to be a number
+template <typename Parse>
+static auto ParseOptionValue(const std::string& name, const std::string& value, Parse parse)
+{
+	using namespace std;
+	try
+	{
+		size_t parsed_length = 0;
+		const auto number = parse(value, &parsed_length);
+		if (parsed_length == value.size())
+		{
+			return number;
+		}
+	}
+	catch (const logic_error&)
+	{
+	}
+	throw invalid_argument("Invalid value of benchmark option "s + name + ": "s + value);
+}
+
+BenchmarkConfig ParseBenchmarkConfig(const std::vector<std::string>& args)
+{
+	using namespace std;
+	BenchmarkConfig config;
+	for (size_t i = 0; i < args.size(); i += 2)
+	{
+		const string& name = args[i];
+		if (i + 1 == args.size())
+		{
+			throw invalid_argument("Missing value of benchmark option "s + name);
+		}
+		const string& value = args[i + 1];
+		const auto parse_count = [&name, &value]
+			{
+				//stoull would wrap a negative count around
+				return ParseOptionValue(name, value.find('-') == string::npos ? value : ""s, [](const string& text, size_t* length)
+					{ return stoull(text, length); });
+			};
+		const auto parse_real = [&name, &value]
+			{
+				return ParseOptionValue(name, value, [](const string& text, size_t* length)
+					{ return stod(text, length); });
+			};
+		if (name == "--documents"s)
+		{
+			config.document_count = parse_count();
+		}
+		else if (name == "--vocabulary"s)
+		{
+			config.vocabulary_size = parse_count();
+		}
+		else if (name == "--document-length"s)
+		{
+			config.document_length = parse_count();
+		}
+		else if (name == "--queries"s)
+		{
+			config.query_count = parse_count();
+		}
+		else if (name == "--query-length"s)
+		{
+			config.query_length = parse_count();
+		}
+		else if (name == "--removes"s)
+		{
+			config.remove_count = parse_count();
+		}
+		else if (name == "--near-duplicates"s)
+		{
+			config.near_duplicate_count = parse_count();
+		}
+		else if (name == "--simulate-nodes"s)
+		{
+			config.simulated_numa_nodes = static_cast<int>(parse_count());
+		}
+		else if (name == "--zipf"s)
+		{
+			config.zipf_exponent = parse_real();
+		}
+		else if (name == "--seed"s)
+		{
+			config.seed = parse_count();
+		}
+		else
+		{
+			throw invalid_argument("Unknown benchmark option "s + name);
+		}
+	}
+	if (config.vocabulary_size == 0 || config.document_count == 0)
+	{
+		throw invalid_argument("Benchmark corpus must not be empty"s);
+	}
+	return config;
+}
+
+static double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Function>
+static uint64_t MeasureNanoseconds(Function function)
+{
+	const auto start = std::chrono::steady_clock::now();
+	function();
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+static long GetPeakRssKilobytes()
+{
+#ifdef __unix__
+	rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+#else
+	return -1;
+#endif
+}
+
+static void PrintLatency(std::ostream& output, const std::string& name, const HistogramSnapshot& latency, double seconds)
+{
+	using namespace std;
+	output << "{\"benchmark\":\""s << name << "\""s
+		<< ",\"operations\":"s << latency.total_count
+		<< ",\"seconds\":"s << seconds
+		<< ",\"ops_per_second\":"s << (seconds > 0 ? latency.total_count / seconds : 0.0)
+		<< ",\"mean_ns\":"s << latency.Mean()
+		<< ",\"p50_ns\":"s << latency.ValueAtPercentile(50)
+		<< ",\"p90_ns\":"s << latency.ValueAtPercentile(90)
+		<< ",\"p99_ns\":"s << latency.ValueAtPercentile(99)
+		<< ",\"max_ns\":"s << latency.max_value << "}"s << endl;
+}
+
+//the previous ConcurrentMap: std::map buckets next to their mutexes, merged into a copy to iterate
+template <typename Key, typename Value>
+class BucketMapBaseline {
+public:
+	struct Access
+	{
+		std::lock_guard<std::mutex> guard;
+		Value& ref_to_value;
+	};
+
+	explicit BucketMapBaseline(size_t bucket_count) : bucket_map_(bucket_count)
+	{
+	}
+
+	Access operator[](const Key& key)
+	{
+		auto& [local_map, its_mutex] = bucket_map_[static_cast<uint64_t>(key) % bucket_map_.size()];
+		return { std::lock_guard(its_mutex), local_map[key] };
+	}
+
+	std::map<Key, Value> BuildOrdinaryMap()
+	{
+		std::map<Key, Value> result;
+		for (auto& [local_map, its_mutex] : bucket_map_)
+		{
+			std::lock_guard guard(its_mutex);
+			result.insert(local_map.begin(), local_map.end());
+		}
+		return result;
+	}
+
+private:
+	std::vector<std::pair<std::map<Key, Value>, std::mutex>> bucket_map_;
+};
+
+//every thread increments counters under its own sequence of keys, then all counters are summed once
+template <typename Map, typename Key, typename SumValues>
+static void BenchmarkConcurrentMap(std::ostream& output, const std::string& name, Map& map,
+	const std::vector<std::vector<Key>>& thread_keys, SumValues sum_values)
+{
+	using namespace std;
+	size_t operations = 0;
+	const auto start = chrono::steady_clock::now();
+	{
+		vector<thread> threads;
+		for (const vector<Key>& keys : thread_keys)
+		{
+			operations += keys.size();
+			threads.emplace_back([&map, &keys]
+				{
+					for (const Key& key : keys)
+					{
+						++map[key].ref_to_value;
+					}
+				});
+		}
+		for (thread& worker : threads)
+		{
+			worker.join();
+		}
+	}
+	const double update_seconds = SecondsSince(start);
+
+	const auto sum_start = chrono::steady_clock::now();
+	const size_t sum = sum_values(map);
+	const double sum_seconds = SecondsSince(sum_start);
+	output << "{\"benchmark\":\""s << name << "\""s
+		<< ",\"threads\":"s << thread_keys.size()
+		<< ",\"operations\":"s << operations
+		<< ",\"seconds\":"s << update_seconds
+		<< ",\"ops_per_second\":"s << operations / update_seconds
+		<< ",\"sum_seconds\":"s << sum_seconds << "}"s << endl;
+	if (sum != operations)
+	{
+		output << "{\"warning\":\"lost updates in "s << name << "\"}"s << endl;
+	}
+}
+
+template <typename ExecutionPolicy, typename Scorer = TfIdfScorer>
+static void BenchmarkFindTopDocuments(std::ostream& output, const std::string& name, const ExecutionPolicy& policy,
+	const SearchServer& search_server, const std::vector<std::string>& queries, const Scorer& scorer = {})
+{
+	const auto is_actual = []([[maybe_unused]] int document_id, DocumentStatus status, [[maybe_unused]] int rating)
+		{ return status == DocumentStatus::ACTUAL; };
+	LatencyHistogram latency;
+	size_t found_documents = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for (const std::string& query : queries)
+	{
+		latency.Record(MeasureNanoseconds([&]
+			{
+				found_documents += search_server.FindTopDocuments(policy, query, is_actual, scorer).size();
+			}));
+	}
+	PrintLatency(output, name, latency.Snapshot(), SecondsSince(start));
+	if (found_documents == 0)
+	{
+		output << "{\"warning\":\"no documents found for "s << name << "\"}"s << std::endl;
+	}
+}
+
+static void PrintConfig(std::ostream& output, const BenchmarkConfig& config)
+{
+	using namespace std;
+	output << "{\"config\":{\"documents\":"s << config.document_count
+		<< ",\"vocabulary\":"s << config.vocabulary_size
+		<< ",\"document_length\":"s << config.document_length
+		<< ",\"queries\":"s << config.query_count
+		<< ",\"query_length\":"s << config.query_length
+		<< ",\"zipf\":"s << config.zipf_exponent
+		<< ",\"seed\":"s << config.seed << "}}"s << endl;
+}
+
+void RunBenchmark(const BenchmarkConfig& config, std::ostream& output)
+{
+	using namespace std;
+	PrintConfig(output, config);
+
+	SyntheticCorpus corpus(config);
+	SearchServer search_server(""s);
+
+	{
+		mt19937_64 generator(config.seed);
+		uniform_int_distribution<int> rating(-10, 10);
+		double seconds = 0.0;
+		for (size_t id = 0; id < config.document_count; ++id)
+		{
+			const string document = corpus.GenerateDocument();
+			const auto status = (id % 10 == 0) ? DocumentStatus::IRRELEVANT : DocumentStatus::ACTUAL;
+			const vector<int> ratings = { rating(generator), rating(generator), rating(generator) };
+
+			const auto start = chrono::steady_clock::now();
+			search_server.AddDocument(static_cast<int>(id), document, status, ratings);
+			seconds += SecondsSince(start);
+		}
+		output << "{\"benchmark\":\"ingest\",\"documents\":"s << config.document_count
+			<< ",\"seconds\":"s << seconds
+			<< ",\"docs_per_second\":"s << config.document_count / seconds
+			<< ",\"index_bytes\":"s << search_server.GetStats().TotalBytes()
+			<< ",\"peak_rss_kb\":"s << GetPeakRssKilobytes() << "}"s << endl;
+	}
+
+	vector<string> queries(config.query_count);
+	for (string& query : queries)
+	{
+		query = corpus.GenerateQuery();
+	}
+
+	ResetMetrics();
+	BenchmarkFindTopDocuments(output, "find_top_documents_seq"s, execution::seq, search_server, queries);
+	BenchmarkFindTopDocuments(output, "find_top_documents_par"s, execution::par, search_server, queries);
+	BenchmarkFindTopDocuments(output, "find_top_documents_bm25_seq"s, execution::seq, search_server, queries, Bm25Scorer{});
+
+	{
+		//top documents of one status plus the status counts and rating histogram of all matches
+		const vector<int> rating_boundaries = { -5, 0, 5 };
+		LatencyHistogram latency;
+		size_t matched_documents = 0;
+		const auto start = chrono::steady_clock::now();
+		for (const string& query : queries)
+		{
+			latency.Record(MeasureNanoseconds([&]
+				{
+					matched_documents += search_server.FindTopDocumentsWithFacets(execution::seq, query, DocumentStatus::ACTUAL, rating_boundaries).facets.GetMatchCount();
+				}));
+		}
+		PrintLatency(output, "find_top_documents_facets_seq"s, latency.Snapshot(), SecondsSince(start));
+		output << "{\"benchmark\":\"facets\",\"matched_documents\":"s << matched_documents << "}"s << endl;
+	}
+
+	{
+		//the leading word of every query alone
+		vector<string> single_term_queries;
+		for (const string& query : queries)
+		{
+			single_term_queries.push_back(query.substr(0, query.find(' ')));
+		}
+		BenchmarkFindTopDocuments(output, "find_top_documents_single_term_seq"s, execution::seq, search_server, single_term_queries);
+	}
+
+	{
+		//the leading word of every query cut to two letters and expanded against the dictionary
+		vector<string> prefix_queries;
+		for (const string& query : queries)
+		{
+			prefix_queries.push_back(query.substr(0, min(query.find(' '), size_t{ 2 })) + "*"s);
+		}
+		BenchmarkFindTopDocuments(output, "find_top_documents_prefix_seq"s, execution::seq, search_server, prefix_queries);
+	}
+
+	{
+		const auto start = chrono::steady_clock::now();
+		const auto results = ProcessQueries(search_server, queries);
+		const double seconds = SecondsSince(start);
+		output << "{\"benchmark\":\"process_queries\",\"queries\":"s << results.size()
+			<< ",\"seconds\":"s << seconds
+			<< ",\"qps\":"s << results.size() / seconds << "}"s << endl;
+	}
+
+	{
+		mt19937_64 generator(config.seed + 1);
+		uniform_int_distribution<size_t> document_id(0, config.document_count - 1);
+		LatencyHistogram latency;
+		const auto start = chrono::steady_clock::now();
+		for (const string& query : queries)
+		{
+			const int id = static_cast<int>(document_id(generator));
+			latency.Record(MeasureNanoseconds([&]
+				{
+					search_server.MatchDocument(query, id);
+				}));
+		}
+		PrintLatency(output, "match_document"s, latency.Snapshot(), SecondsSince(start));
+	}
+
+	{
+		LatencyHistogram latency;
+		const size_t remove_count = min(config.remove_count, config.document_count);
+		const auto start = chrono::steady_clock::now();
+		for (size_t id = 0; id < remove_count; ++id)
+		{
+			latency.Record(MeasureNanoseconds([&]
+				{
+					search_server.RemoveDocument(static_cast<int>(id));
+				}));
+		}
+		PrintLatency(output, "remove_document"s, latency.Snapshot(), SecondsSince(start));
+	}
+
+	{
+		const size_t first_id = min(config.remove_count, config.document_count);
+		const size_t last_id = min(2 * config.remove_count, config.document_count);
+		vector<int> document_ids(last_id - first_id);
+		iota(document_ids.begin(), document_ids.end(), static_cast<int>(first_id));
+
+		const auto start = chrono::steady_clock::now();
+		search_server.RemoveDocuments(execution::par, document_ids);
+		const double seconds = SecondsSince(start);
+		output << "{\"benchmark\":\"remove_documents_batch\",\"documents\":"s << document_ids.size()
+			<< ",\"seconds\":"s << seconds
+			<< ",\"docs_per_second\":"s << document_ids.size() / seconds << "}"s << endl;
+	}
+
+	{
+		//an upper case letter never occurs in the corpus, so the first word of every query has to be corrected
+		vector<string> typo_queries = queries;
+		for (string& query : typo_queries)
+		{
+			query[0] = 'A';
+		}
+		search_server.EnableFuzzyMatching();
+		BenchmarkFindTopDocuments(output, "find_top_documents_fuzzy_seq"s, execution::seq, search_server, typo_queries);
+		output << "{\"benchmark\":\"fuzzy_index\",\"bytes\":"s << search_server.GetStats().fuzzy_index_bytes << "}"s << endl;
+	}
+
+	{
+		SearchServer near_duplicate_server(""s);
+		NearDuplicateOptions options;
+		options.reject = true;
+		near_duplicate_server.EnableNearDuplicateDetection(options);
+
+		//every fourth document repeats the previous one with a single word appended
+		size_t rejected = 0;
+		string previous_document;
+		const auto start = chrono::steady_clock::now();
+		for (size_t id = 0; id < config.near_duplicate_count; ++id)
+		{
+			const string document = (id % 4 == 3) ? previous_document + " "s + corpus.GenerateQuery() : corpus.GenerateDocument();
+			try
+			{
+				near_duplicate_server.AddDocument(static_cast<int>(id), document, DocumentStatus::ACTUAL, {});
+			}
+			catch (const invalid_argument&)
+			{
+				++rejected;
+			}
+			previous_document = document;
+		}
+		const double seconds = SecondsSince(start);
+		output << "{\"benchmark\":\"near_duplicate_ingest\",\"documents\":"s << config.near_duplicate_count
+			<< ",\"rejected\":"s << rejected
+			<< ",\"seconds\":"s << seconds
+			<< ",\"docs_per_second\":"s << config.near_duplicate_count / seconds << "}"s << endl;
+	}
+
+	{
+		//a corpus like the ingested one, written to a file and bulk loaded into a fresh server
+		const string path = (filesystem::temp_directory_path() / "search_server_benchmark_corpus.tsv"s).string();
+		{
+			SyntheticCorpus file_corpus(config);
+			ofstream corpus_file(path, ios::binary);
+			for (size_t id = 0; id < config.document_count; ++id)
+			{
+				corpus_file << id << "\t0\t1 2 3\t"s << file_corpus.GenerateDocument() << '\n';
+			}
+		}
+
+		SearchServer loaded_server(""s);
+		const auto start = chrono::steady_clock::now();
+		const CorpusLoadResult result = LoadCorpus(loaded_server, path);
+		const double seconds = SecondsSince(start);
+		filesystem::remove(path);
+		output << "{\"benchmark\":\"corpus_load\",\"documents\":"s << result.document_count
+			<< ",\"bytes\":"s << result.byte_count
+			<< ",\"seconds\":"s << seconds
+			<< ",\"docs_per_second\":"s << result.document_count / seconds << "}"s << endl;
+	}
+
+	{
+		//queries are logged on a fresh server, and the saved log is read back to drive its warmup
+		SearchServer logged_server(""s);
+		SyntheticCorpus logged_corpus(config);
+		for (size_t id = 0; id < config.document_count; ++id)
+		{
+			logged_server.AddDocument(static_cast<int>(id), logged_corpus.GenerateDocument(), DocumentStatus::ACTUAL, {});
+		}
+		logged_server.EnableQueryLog();
+		BenchmarkFindTopDocuments(output, "find_top_documents_logged_seq"s, execution::seq, logged_server, queries);
+		stringstream query_log;
+		WriteQueryLog(query_log, logged_server.GetHotTerms(1000));
+
+		const auto start = chrono::steady_clock::now();
+		const WarmupResult result = logged_server.WarmUp(ReadQueryLog(query_log)).get();
+		const double seconds = SecondsSince(start);
+		output << "{\"benchmark\":\"warmup\",\"terms\":"s << result.term_count
+			<< ",\"postings\":"s << result.posting_count
+			<< ",\"log_bytes\":"s << query_log.str().size()
+			<< ",\"seconds\":"s << seconds << "}"s << endl;
+	}
+
+	{
+		//zipf distributed word ranks, so a few hot keys are hit by every thread at once
+		const size_t thread_count = max<size_t>(thread::hardware_concurrency(), 2);
+		ZipfDistribution words(config.vocabulary_size, config.zipf_exponent);
+		mt19937_64 generator(config.seed + 2);
+		vector<vector<uint32_t>> thread_ranks(thread_count);
+		vector<string> word_texts(config.vocabulary_size);
+		for (size_t rank = 0; rank < word_texts.size(); ++rank)
+		{
+			word_texts[rank] = SyntheticCorpus::MakeWord(rank);
+		}
+		vector<vector<string_view>> thread_words(thread_count);
+		for (size_t i = 0; i < thread_count; ++i)
+		{
+			for (size_t j = 0; j < config.document_count * 10 / thread_count; ++j)
+			{
+				const size_t rank = words(generator);
+				thread_ranks[i].push_back(static_cast<uint32_t>(rank));
+				thread_words[i].push_back(word_texts[rank]);
+			}
+		}
+
+		BucketMapBaseline<uint32_t, size_t> baseline(MAX_BUCKET_MAP_COUNT);
+		BenchmarkConcurrentMap(output, "concurrent_map_baseline"s, baseline, thread_ranks, [](auto& map)
+			{
+				size_t sum = 0;
+				for (const auto& [key, value] : map.BuildOrdinaryMap())
+				{
+					sum += value;
+				}
+				return sum;
+			});
+
+		const auto sum_in_place = [](auto& map)
+			{
+				atomic<size_t> sum = 0;
+				map.ForEachShard(execution::par, [&sum](const auto& range)
+					{
+						size_t shard_sum = 0;
+						for (const auto& [key, value] : range)
+						{
+							shard_sum += value;
+						}
+						sum += shard_sum;
+					});
+				return sum.load();
+			};
+		ConcurrentMap<uint32_t, size_t> striped(MAX_BUCKET_MAP_COUNT);
+		BenchmarkConcurrentMap(output, "concurrent_map_striped"s, striped, thread_ranks, sum_in_place);
+		ConcurrentMap<string_view, size_t> striped_words(MAX_BUCKET_MAP_COUNT);
+		BenchmarkConcurrentMap(output, "concurrent_map_striped_string_view"s, striped_words, thread_words, sum_in_place);
+	}
+
+	output << "{\"benchmark\":\"stages\",\"metrics\":"s;
+	ExportMetrics(output, TakeMetricsSnapshot());
+	output << ",\"peak_rss_kb\":"s << GetPeakRssKilobytes() << "}"s << endl;
+}
+
+void RunNumaBenchmark(const BenchmarkConfig& config, std::ostream& output)
+{
+	using namespace std;
+	PrintConfig(output, config);
+
+	const vector<NumaNode> nodes = config.simulated_numa_nodes > 0 ? SimulateNumaTopology(config.simulated_numa_nodes) : ReadNumaTopology();
+	for (const NumaNode& node : nodes)
+	{
+		output << "{\"numa_node\":"s << node.id << ",\"cpus\":"s << node.cpus.size() << "}"s << endl;
+	}
+
+	SyntheticCorpus corpus(config);
+	vector<string> documents(config.document_count);
+	for (string& document : documents)
+	{
+		document = corpus.GenerateDocument();
+	}
+	vector<string> queries(config.query_count);
+	for (string& query : queries)
+	{
+		query = corpus.GenerateQuery();
+	}
+
+	const auto build_start = chrono::steady_clock::now();
+	const ReplicatedSearchServer replicated_server(nodes, [&documents]
+		{
+			auto search_server = make_unique<SearchServer>(""s);
+			for (size_t id = 0; id < documents.size(); ++id)
+			{
+				search_server->AddDocument(static_cast<int>(id), documents[id], DocumentStatus::ACTUAL, {});
+			}
+			return search_server;
+		});
+	output << "{\"benchmark\":\"numa_replicate\",\"replicas\":"s << nodes.size()
+		<< ",\"seconds\":"s << SecondsSince(build_start)
+		<< ",\"peak_rss_kb\":"s << GetPeakRssKilobytes() << "}"s << endl;
+
+	//the existing std::execution::par path over a single copy, for reference
+	const auto start = chrono::steady_clock::now();
+	const auto expected = ProcessQueries(replicated_server.GetReplica(0), queries);
+	const double seconds = SecondsSince(start);
+	output << "{\"benchmark\":\"process_queries\",\"queries\":"s << queries.size()
+		<< ",\"seconds\":"s << seconds
+		<< ",\"qps\":"s << queries.size() / seconds << "}"s << endl;
+
+	size_t worker_count = 0;
+	for (size_t node_count = 1; node_count <= nodes.size(); ++node_count)
+	{
+		worker_count += nodes[node_count - 1].cpus.size();
+		const auto node_start = chrono::steady_clock::now();
+		const auto results = replicated_server.ProcessQueries(queries, node_count);
+		const double node_seconds = SecondsSince(node_start);
+		output << "{\"benchmark\":\"numa_process_queries\",\"nodes\":"s << node_count
+			<< ",\"workers\":"s << worker_count
+			<< ",\"seconds\":"s << node_seconds
+			<< ",\"qps\":"s << queries.size() / node_seconds << "}"s << endl;
+		const bool same_results = equal(results.begin(), results.end(), expected.begin(), [](const auto& lhs, const auto& rhs)
+			{
+				return equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](const Document& l, const Document& r) { return l.id == r.id; });
+			});
+		if (!same_results)
+		{
+			output << "{\"warning\":\"replicas disagree with a single server\"}"s << endl;
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+struct BenchmarkConfig {
+	size_t document_count = 100000;
+	size_t vocabulary_size = 50000;
+	size_t document_length = 50;
+	size_t query_count = 10000;
+	size_t query_length = 3;
+	size_t remove_count = 1000;
+	size_t near_duplicate_count = 10000;
+	//RunNumaBenchmark splits the cpus into this many nodes instead of reading the topology when non-zero
+	int simulated_numa_nodes = 0;
+	double zipf_exponent = 1.0;
+	uint64_t seed = 42;
+};
+
+//draws ranks 0..size-1 with probability proportional to 1 / (rank + 1)^exponent
+class ZipfDistribution {
+public:
+	ZipfDistribution(size_t size, double exponent);
+
+	size_t operator()(std::mt19937_64& generator) const;
+
+private:
+	std::vector<double> cumulative_;
+};
+
+class SyntheticCorpus {
+public:
+	explicit SyntheticCorpus(const BenchmarkConfig&);
+
+	std::string GenerateDocument();
+
+	std::string GenerateQuery();
+
+	static std::string MakeWord(size_t rank);
+
+private:
+	const BenchmarkConfig config_;
+	ZipfDistribution words_;
+	std::mt19937_64 generator_;
+};
+
+BenchmarkConfig ParseBenchmarkConfig(const std::vector<std::string>& args);
+
+//prints one JSON object per measured stage
+void RunBenchmark(const BenchmarkConfig&, std::ostream&);
+
+//query throughput with per-node replicas, using the first 1, 2, ... nodes
+void RunNumaBenchmark(const BenchmarkConfig&, std::ostream&);
@@ -1,75 +1,281 @@
 #pragma once
-#include <map>
-#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <execution>
+#include <functional>
 #include <iterator>
+#include <map>
 #include <mutex>
+#include <numeric>
+#include <utility>
+#include <vector>
 
 using namespace std::string_literals;
 
-template <typename Key, typename Value>
+const static size_t CACHE_LINE_SIZE = 64;
+
+//hash map split into independently locked shards, each an open addressing table with linear probing;
+//Key needs a default constructor, operator== and a Hash
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
 class ConcurrentMap {
 private:
-	const size_t size_maps_;
-	std::vector<std::pair<std::map<Key, Value>, std::mutex>> bucket_map_;
-	std::map<Key, Value> ordinary_map_;
+	//padded to a cache line so neighbouring shard mutexes do not share one
+	struct alignas(CACHE_LINE_SIZE) Shard
+	{
+		std::mutex mutex;
+		std::vector<std::pair<Key, Value>> slots;
+		std::vector<uint8_t> occupied;
+		size_t size = 0;
+	};
 
-public:
-	static_assert(std::is_integral_v<Key>, "ConcurrentMap supports only integer keys");
+	std::vector<Shard> shards_;
+	Hash hash_;
+
+	//std::hash of an integer is the integer itself, so the bits are mixed before picking a shard and a slot
+	uint64_t GetHash(const Key& key) const
+	{
+		uint64_t hash = static_cast<uint64_t>(hash_(key));
+		hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+		hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+		return hash ^ (hash >> 31);
+	}
+
+	Shard& GetShard(uint64_t hash)
+	{
+		return shards_[(hash >> 32) % shards_.size()];
+	}
+
+	static size_t FindSlot(const Shard& shard, const Key& key, uint64_t hash)
+	{
+		const size_t mask = shard.slots.size() - 1;
+		size_t slot = hash & mask;
+		while (shard.occupied[slot] && !(shard.slots[slot].first == key))
+		{
+			slot = (slot + 1) & mask;
+		}
+		return slot;
+	}
+
+	void Grow(Shard& shard)
+	{
+		std::vector<std::pair<Key, Value>> slots(std::max<size_t>(shard.slots.size() * 2, 16));
+		std::vector<uint8_t> occupied(slots.size());
+		slots.swap(shard.slots);
+		occupied.swap(shard.occupied);
+		for (size_t i = 0; i < slots.size(); ++i)
+		{
+			if (occupied[i])
+			{
+				const size_t slot = FindSlot(shard, slots[i].first, GetHash(slots[i].first));
+				shard.slots[slot] = std::move(slots[i]);
+				shard.occupied[slot] = 1;
+			}
+		}
+	}
 
+public:
 	struct Access
 	{
 		std::lock_guard<std::mutex> guard;
 		Value& ref_to_value;
+	};
+
+	//walks the occupied slots of a range of shards in place; not synchronised with writers
+	class Iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = std::pair<Key, Value>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = value_type*;
+		using reference = value_type&;
+
+		Iterator(Shard* shard, Shard* last_shard, size_t slot)
+			: shard_(shard), last_shard_(last_shard), slot_(slot)
+		{
+			SkipEmpty();
+		}
+
+		reference operator*() const
+		{
+			return shard_->slots[slot_];
+		}
+
+		pointer operator->() const
+		{
+			return &shard_->slots[slot_];
+		}
+
+		Iterator& operator++()
+		{
+			++slot_;
+			SkipEmpty();
+			return *this;
+		}
+
+		Iterator operator++(int)
+		{
+			Iterator previous = *this;
+			++*this;
+			return previous;
+		}
+
+		bool operator==(const Iterator& other) const
+		{
+			return shard_ == other.shard_ && slot_ == other.slot_;
+		}
+
+		bool operator!=(const Iterator& other) const
+		{
+			return !(*this == other);
+		}
+
+	private:
+		Shard* shard_;
+		Shard* last_shard_;
+		size_t slot_;
+
+		void SkipEmpty()
+		{
+			while (shard_ != last_shard_)
+			{
+				while (slot_ < shard_->slots.size() && !shard_->occupied[slot_])
+				{
+					++slot_;
+				}
+				if (slot_ < shard_->slots.size())
+				{
+					return;
+				}
+				++shard_;
+				slot_ = 0;
+			}
+		}
+	};
+
+	struct ShardRange
+	{
+		Iterator first;
+		Iterator last;
+
+		Iterator begin() const
+		{
+			return first;
+		}
 
+		Iterator end() const
+		{
+			return last;
+		}
 	};
 
-	// bucket_count      
-	explicit ConcurrentMap(size_t bucket_count) : size_maps_(bucket_count), bucket_map_(bucket_count)
+	//shard_count bounds how many threads may write without waiting on each other
+	explicit ConcurrentMap(size_t shard_count, const Hash& hash = {})
+		: shards_(std::max<size_t>(shard_count, 1)), hash_(hash)
 	{
 	}
 
 	Access operator[](const Key& key)
 	{
-		uint64_t u_key = static_cast<uint64_t>(key);
-		auto index = u_key % size_maps_;
-		return { std::lock_guard(bucket_map_[index].second),  bucket_map_[index].first[u_key] };
+		const uint64_t hash = GetHash(key);
+		Shard& shard = GetShard(hash);
+		std::unique_lock lock(shard.mutex);
+		//keeps the load factor at or below 3/4 so probe sequences stay short
+		if ((shard.size + 1) * 4 > shard.slots.size() * 3)
+		{
+			Grow(shard);
+		}
+		const size_t slot = FindSlot(shard, key, hash);
+		if (!shard.occupied[slot])
+		{
+			shard.slots[slot] = { key, Value() };
+			shard.occupied[slot] = 1;
+			++shard.size;
+		}
+		lock.release();
+		return { std::lock_guard(shard.mutex, std::adopt_lock), shard.slots[slot].second };
 	}
 
-	std::map<Key, Value> BuildOrdinaryMap()
+	size_t erase(const Key& key)
 	{
-		std::map<Key, Value> result;
-		for (auto& [local_map, its_mutex] : bucket_map_)
+		const uint64_t hash = GetHash(key);
+		Shard& shard = GetShard(hash);
+		std::lock_guard guard(shard.mutex);
+		if (shard.size == 0)
 		{
-			std::lock_guard guard(its_mutex);
-			result.merge(local_map);
+			return 0;
 		}
-		return result;
+		size_t slot = FindSlot(shard, key, hash);
+		if (!shard.occupied[slot])
+		{
+			return 0;
+		}
+
+		//backward shift deletion: later entries of the probe run move up so lookups need no tombstones
+		const size_t mask = shard.slots.size() - 1;
+		for (size_t next = (slot + 1) & mask; shard.occupied[next]; next = (next + 1) & mask)
+		{
+			const size_t home = GetHash(shard.slots[next].first) & mask;
+			if (((next - home) & mask) >= ((next - slot) & mask))
+			{
+				shard.slots[slot] = std::move(shard.slots[next]);
+				slot = next;
+			}
+		}
+		shard.slots[slot] = {};
+		shard.occupied[slot] = 0;
+		--shard.size;
+		return 1;
 	}
 
-	typename std::map<Key, Value>::iterator begin()
+	size_t size() const
 	{
-		ordinary_map_ = BuildOrdinaryMap();
-		return ordinary_map_.begin();
+		return std::accumulate(shards_.begin(), shards_.end(), size_t{ 0 }, [](size_t sum, const Shard& shard)
+			{ return sum + shard.size; });
 	}
 
-	typename std::map<Key, Value>::iterator end()
+	Iterator begin()
 	{
-		if (ordinary_map_.empty()) {
-			ordinary_map_ = BuildOrdinaryMap();
-		}
-		return ordinary_map_.end();
+		return Iterator(shards_.data(), shards_.data() + shards_.size(), 0);
 	}
 
-	size_t erase(const Key& key)
+	Iterator end()
+	{
+		return Iterator(shards_.data() + shards_.size(), shards_.data() + shards_.size(), 0);
+	}
+
+	//calls function(range) for every shard under its lock, shards in parallel with a parallel policy
+	template <typename ExecutionPolicy, typename Function>
+	void ForEachShard(const ExecutionPolicy& policy, Function function)
 	{
-		uint64_t u_key = static_cast<uint64_t>(key);
-		auto index = u_key % size_maps_;
+		std::for_each(policy, shards_.begin(), shards_.end(), [&](Shard& shard)
+			{
+				std::lock_guard guard(shard.mutex);
+				function(ShardRange{ Iterator(&shard, &shard + 1, 0), Iterator(&shard + 1, &shard + 1, 0) });
+			});
+	}
 
-		std::lock_guard guard(bucket_map_[index].second);
-		if (bucket_map_[index].first.count(key) != 0) {
-			bucket_map_[index].first.erase(key);
-			return 1;
-		}
-		return 0;
+	//calls function(key, value) for every entry in place
+	template <typename ExecutionPolicy, typename Function>
+	void ForEach(const ExecutionPolicy& policy, Function function)
+	{
+		ForEachShard(policy, [&](const ShardRange& range)
+			{
+				for (auto& [key, value] : range)
+				{
+					function(key, value);
+				}
+			});
+	}
+
+	std::map<Key, Value> BuildOrdinaryMap()
+	{
+		std::map<Key, Value> result;
+		ForEach(std::execution::seq, [&result](const Key& key, Value& value)
+			{
+				result.emplace(key, value);
+			});
+		return result;
 	}
-};
\ No newline at end of file
+};
@@ -0,0 +1,223 @@
+#include "corpus_loader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <execution>
+#include <future>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+using namespace std::literals;
+
+MappedFile::MappedFile(const std::string& path)
+{
+#ifdef __unix__
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		throw std::runtime_error("Cannot open corpus file "s + path);
+	}
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0)
+	{
+		close(fd);
+		throw std::runtime_error("Cannot stat corpus file "s + path);
+	}
+
+	size_ = static_cast<size_t>(file_stat.st_size);
+	if (size_ != 0)
+	{
+		void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED)
+		{
+			close(fd);
+			throw std::runtime_error("Cannot map corpus file "s + path);
+		}
+		madvise(data, size_, MADV_SEQUENTIAL);
+		data_ = static_cast<const char*>(data);
+	}
+	//the mapping stays valid after the descriptor is closed
+	close(fd);
+#else
+	std::ifstream input(path, std::ios::binary);
+	if (!input)
+	{
+		throw std::runtime_error("Cannot open corpus file "s + path);
+	}
+	buffer_.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+	data_ = buffer_.data();
+	size_ = buffer_.size();
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef __unix__
+	if (data_ != nullptr)
+	{
+		munmap(const_cast<char*>(data_), size_);
+	}
+#endif
+}
+
+std::string_view MappedFile::GetData() const
+{
+	return { data_, size_ };
+}
+
+struct CorpusRecord {
+	int id;
+	DocumentStatus status;
+	std::vector<int> ratings;
+	std::string_view text;
+};
+
+static std::string_view ReadField(std::string_view& data, char delimiter)
+{
+	const size_t end = data.find(delimiter);
+	if (end == std::string_view::npos)
+	{
+		throw std::invalid_argument("Truncated corpus record"s);
+	}
+	const std::string_view field = data.substr(0, end);
+	data.remove_prefix(end + 1);
+	return field;
+}
+
+template <typename Number>
+static Number ParseNumber(std::string_view text)
+{
+	Number value{};
+	const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+	if (error != std::errc() || end != text.data() + text.size())
+	{
+		throw std::invalid_argument("Invalid number in corpus record: "s + std::string(text));
+	}
+	return value;
+}
+
+static CorpusRecord ReadRecord(std::string_view& data, CorpusFormat format)
+{
+	CorpusRecord record;
+	record.id = ParseNumber<int>(ReadField(data, '\t'));
+
+	const int status = ParseNumber<int>(ReadField(data, '\t'));
+	if (status < static_cast<int>(DocumentStatus::ACTUAL) || status > static_cast<int>(DocumentStatus::REMOVED))
+	{
+		throw std::invalid_argument("Invalid document status in corpus record"s);
+	}
+	record.status = static_cast<DocumentStatus>(status);
+
+	std::string_view ratings = ReadField(data, '\t');
+	while (!ratings.empty())
+	{
+		const size_t end = std::min(ratings.find(' '), ratings.size());
+		if (end != 0)
+		{
+			record.ratings.push_back(ParseNumber<int>(ratings.substr(0, end)));
+		}
+		ratings.remove_prefix(std::min(end + 1, ratings.size()));
+	}
+
+	if (format == CorpusFormat::LINES)
+	{
+		const size_t end = std::min(data.find('\n'), data.size());
+		record.text = data.substr(0, end);
+		data.remove_prefix(std::min(end + 1, data.size()));
+		if (!record.text.empty() && record.text.back() == '\r')
+		{
+			record.text.remove_suffix(1);
+		}
+	}
+	else
+	{
+		const size_t length = ParseNumber<size_t>(ReadField(data, '\n'));
+		if (length > data.size())
+		{
+			throw std::invalid_argument("Truncated corpus record"s);
+		}
+		record.text = data.substr(0, length);
+		data.remove_prefix(length);
+		if (!data.empty() && data.front() == '\n')
+		{
+			data.remove_prefix(1);
+		}
+	}
+	return record;
+}
+
+CorpusLoadResult LoadCorpus(SearchServer& search_server, const std::string& path, const CorpusLoadOptions& options)
+{
+	const auto file = std::make_shared<MappedFile>(path);
+	std::string_view data = file->GetData();
+
+	CorpusLoadResult result;
+	result.byte_count = data.size();
+
+	//splits the next batch of records and tokenizes them in parallel; documents the server refuses become nullopt
+	const auto prepare_batch = [&search_server, &options, &data]()
+		{
+			std::vector<CorpusRecord> records;
+			while (!data.empty() && records.size() < std::max<size_t>(options.batch_size, 1))
+			{
+				records.push_back(ReadRecord(data, options.format));
+			}
+
+			std::vector<std::optional<SearchServer::PreparedDocument>> documents(records.size());
+			std::transform(std::execution::par, records.begin(), records.end(), documents.begin(), [&search_server](const CorpusRecord& record)
+				-> std::optional<SearchServer::PreparedDocument>
+				{
+					try
+					{
+						return search_server.PrepareDocument(record.id, record.text, record.status, record.ratings);
+					}
+					catch (const std::invalid_argument&)
+					{
+						return std::nullopt;
+					}
+				});
+			return documents;
+		};
+
+	//the next batch is read and tokenized in the background while this thread indexes the current one
+	auto next_batch = std::async(std::launch::async, prepare_batch);
+	while (true)
+	{
+		auto documents = next_batch.get();
+		if (documents.empty())
+		{
+			break;
+		}
+		next_batch = std::async(std::launch::async, prepare_batch);
+
+		for (auto& document : documents)
+		{
+			if (!document)
+			{
+				++result.rejected_count;
+				continue;
+			}
+			try
+			{
+				search_server.AddPreparedDocument(std::move(*document), file);
+				++result.document_count;
+			}
+			catch (const std::invalid_argument&)
+			{
+				++result.rejected_count;
+			}
+		}
+	}
+	return result;
+}
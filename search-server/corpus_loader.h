@@ -0,0 +1,49 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "search_server.h"
+
+enum class CorpusFormat {
+	//id \t status \t ratings \t text \n
+	LINES,
+	//id \t status \t ratings \t text length in bytes \n, then exactly that many bytes of text, which are not scanned for a delimiter, and an optional \n
+	LENGTH_PREFIXED
+};
+
+//status is the numeric value of DocumentStatus, ratings are separated by spaces and may be empty
+struct CorpusLoadOptions {
+	CorpusFormat format = CorpusFormat::LINES;
+	size_t batch_size = 4096;
+};
+
+struct CorpusLoadResult {
+	size_t document_count = 0;
+	size_t rejected_count = 0;
+	size_t byte_count = 0;
+};
+
+//read-only contents of a whole file, memory-mapped where the platform allows it
+class MappedFile {
+public:
+	explicit MappedFile(const std::string& path);
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile();
+
+	std::string_view GetData() const;
+
+private:
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+#ifndef __unix__
+	std::string buffer_;
+#endif
+};
+
+//the server indexes the mapped bytes in place and keeps the mapping alive;
+//documents it rejects (invalid id or word, near duplicate) are counted and skipped, malformed records throw
+CorpusLoadResult LoadCorpus(SearchServer& search_server, const std::string& path, const CorpusLoadOptions& options = {});
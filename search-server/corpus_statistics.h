@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+
+//document counts and lengths needed to score over several indexes as if they were one
+struct CorpusStatistics {
+	int document_count = 0;
+	uint64_t total_document_length = 0;
+	//plus words of the query and every dictionary term a prefix* query term expands to
+	std::map<std::string, int, std::less<>> document_freqs;
+
+	void Merge(const CorpusStatistics& other)
+	{
+		document_count += other.document_count;
+		total_document_length += other.total_document_length;
+		for (const auto& [word, document_freq] : other.document_freqs)
+		{
+			document_freqs[word] += document_freq;
+		}
+	}
+};
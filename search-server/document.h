@@ -17,4 +17,7 @@ enum class DocumentStatus {
 	REMOVED
 };
 
+//REMOVED has to stay the last status
+const static size_t DOCUMENT_STATUS_COUNT = static_cast<size_t>(DocumentStatus::REMOVED) + 1;
+
 std::ostream& operator<<(std::ostream&, Document);
\ No newline at end of file
@@ -0,0 +1,76 @@
+#include "document_positions.h"
+
+#include <utility>
+
+void DocumentPositions::AddTerm(const std::vector<uint32_t>& positions)
+{
+	uint32_t previous = 0;
+	for (const uint32_t position : positions)
+	{
+		uint32_t delta = position - previous;
+		previous = position;
+		while (delta >= 0x80)
+		{
+			data_.push_back(static_cast<uint8_t>(delta | 0x80));
+			delta >>= 7;
+		}
+		data_.push_back(static_cast<uint8_t>(delta));
+	}
+	offsets_.push_back(static_cast<uint32_t>(data_.size()));
+}
+
+std::vector<uint32_t> DocumentPositions::GetPositions(size_t entry_index) const
+{
+	std::vector<uint32_t> positions;
+	uint32_t position = 0;
+	uint32_t delta = 0;
+	int shift = 0;
+	for (uint32_t i = offsets_[entry_index]; i < offsets_[entry_index + 1]; ++i)
+	{
+		delta |= static_cast<uint32_t>(data_[i] & 0x7f) << shift;
+		if (data_[i] & 0x80)
+		{
+			shift += 7;
+			continue;
+		}
+		position += delta;
+		positions.push_back(position);
+		delta = 0;
+		shift = 0;
+	}
+	return positions;
+}
+
+size_t DocumentPositions::GetByteSize() const
+{
+	return offsets_.capacity() * sizeof(uint32_t) + data_.capacity();
+}
+
+bool DocumentPositions::ContainsPhrase(const std::vector<std::vector<uint32_t>>& phrase_positions)
+{
+	if (phrase_positions.empty())
+	{
+		return true;
+	}
+
+	std::vector<uint32_t> starts = phrase_positions.front();
+	for (uint32_t k = 1; k < phrase_positions.size() && !starts.empty(); ++k)
+	{
+		const std::vector<uint32_t>& positions = phrase_positions[k];
+		std::vector<uint32_t> matched_starts;
+		auto it = positions.begin();
+		for (const uint32_t start : starts)
+		{
+			while (it != positions.end() && *it < start + k)
+			{
+				++it;
+			}
+			if (it != positions.end() && *it == start + k)
+			{
+				matched_starts.push_back(start);
+			}
+		}
+		starts = std::move(matched_starts);
+	}
+	return !starts.empty();
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//word positions of one document, one delta + varint encoded list per forward index entry
+class DocumentPositions {
+public:
+	void AddTerm(const std::vector<uint32_t>& positions);
+
+	std::vector<uint32_t> GetPositions(size_t entry_index) const;
+
+	size_t GetByteSize() const;
+
+	//phrase_positions[k] - positions of the k-th phrase word; true if some p has p + k in every list
+	static bool ContainsPhrase(const std::vector<std::vector<uint32_t>>& phrase_positions);
+
+private:
+	std::vector<uint32_t> offsets_ = { 0 };
+	std::vector<uint8_t> data_;
+};
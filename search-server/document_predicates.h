@@ -0,0 +1,20 @@
+#pragma once
+#include "document.h"
+
+//FindTopDocuments recognises these filters at compile time and skips the predicate call for them;
+//any other callable taking (document_id, status, rating) still works
+struct AcceptAllDocuments {
+	bool operator()([[maybe_unused]] int document_id, [[maybe_unused]] DocumentStatus status, [[maybe_unused]] int rating) const
+	{
+		return true;
+	}
+};
+
+struct DocumentStatusIs {
+	DocumentStatus status;
+
+	bool operator()([[maybe_unused]] int document_id, DocumentStatus document_status, [[maybe_unused]] int rating) const
+	{
+		return document_status == status;
+	}
+};
@@ -0,0 +1,67 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "document.h"
+
+//per-status match counts and a rating histogram over every document matching a query, whatever the predicate
+struct SearchFacets {
+	std::array<size_t, DOCUMENT_STATUS_COUNT> status_counts = {};
+	//bucket i counts ratings in [rating_boundaries[i - 1], rating_boundaries[i]), the first and last buckets are open
+	std::vector<int> rating_boundaries;
+	std::vector<size_t> rating_counts;
+
+	//without boundaries every rating falls into the one open bucket
+	SearchFacets()
+		: rating_counts(1)
+	{
+	}
+
+	explicit SearchFacets(std::vector<int> boundaries)
+		: rating_boundaries(std::move(boundaries)), rating_counts(rating_boundaries.size() + 1)
+	{
+		std::sort(rating_boundaries.begin(), rating_boundaries.end());
+	}
+
+	void Add(DocumentStatus status, int rating)
+	{
+		++status_counts[static_cast<size_t>(status)];
+		++rating_counts[std::upper_bound(rating_boundaries.begin(), rating_boundaries.end(), rating) - rating_boundaries.begin()];
+	}
+
+	//both sides must have been built from the same boundaries
+	void Merge(const SearchFacets& other)
+	{
+		if (other.rating_boundaries != rating_boundaries)
+		{
+			throw std::invalid_argument("Facets with different rating boundaries cannot be merged");
+		}
+		for (size_t i = 0; i < status_counts.size(); ++i)
+		{
+			status_counts[i] += other.status_counts[i];
+		}
+		for (size_t i = 0; i < rating_counts.size(); ++i)
+		{
+			rating_counts[i] += other.rating_counts[i];
+		}
+	}
+
+	size_t GetMatchCount() const
+	{
+		size_t count = 0;
+		for (const size_t status_count : status_counts)
+		{
+			count += status_count;
+		}
+		return count;
+	}
+};
+
+struct SearchResult {
+	std::vector<Document> documents;
+	SearchFacets facets;
+};
@@ -0,0 +1,183 @@
+#include "fuzzy_index.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+using namespace std::literals;
+
+static uint64_t HashWord(std::string_view word)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (const char c : word)
+	{
+		hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+	}
+	hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+	hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+	return hash ^ (hash >> 31);
+}
+
+FuzzyIndex::FuzzyIndex(const FuzzyMatchingOptions& options)
+	: options_(options)
+{
+	if (options.max_edit_distance < 1 || options.max_edit_distance > 2)
+	{
+		throw std::invalid_argument("Fuzzy matching supports edit distance 1 or 2"s);
+	}
+	if (options.prefix_length <= static_cast<size_t>(options.max_edit_distance))
+	{
+		throw std::invalid_argument("Fuzzy matching prefix must be longer than the edit distance"s);
+	}
+}
+
+const FuzzyMatchingOptions& FuzzyIndex::GetOptions() const
+{
+	return options_;
+}
+
+std::vector<uint64_t> FuzzyIndex::GetDeleteKeys(std::string_view word) const
+{
+	std::vector<std::string> variants = { std::string(word.substr(0, options_.prefix_length)) };
+	std::vector<uint64_t> keys = { HashWord(variants.front()) };
+	for (int distance = 0; distance < options_.max_edit_distance; ++distance)
+	{
+		std::vector<std::string> next_variants;
+		for (const std::string& variant : variants)
+		{
+			for (size_t i = 0; i < variant.size(); ++i)
+			{
+				next_variants.push_back(variant.substr(0, i) + variant.substr(i + 1));
+			}
+		}
+		std::sort(next_variants.begin(), next_variants.end());
+		next_variants.erase(std::unique(next_variants.begin(), next_variants.end()), next_variants.end());
+		for (const std::string& variant : next_variants)
+		{
+			keys.push_back(HashWord(variant));
+		}
+		variants = std::move(next_variants);
+	}
+
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+	return keys;
+}
+
+void FuzzyIndex::AddTerm(uint32_t term_id, std::string_view term)
+{
+	for (const uint64_t key : GetDeleteKeys(term))
+	{
+		deletes_[key].push_back(term_id);
+		++entry_count_;
+	}
+}
+
+void FuzzyIndex::RemoveTerm(uint32_t term_id, std::string_view term)
+{
+	for (const uint64_t key : GetDeleteKeys(term))
+	{
+		const auto entry = deletes_.find(key);
+		std::vector<uint32_t>& term_ids = entry->second;
+		term_ids.erase(std::find(term_ids.begin(), term_ids.end(), term_id));
+		--entry_count_;
+		if (term_ids.empty())
+		{
+			deletes_.erase(entry);
+		}
+	}
+}
+
+std::vector<std::pair<uint32_t, int>> FuzzyIndex::Lookup(std::string_view word, const std::vector<std::string_view>& terms) const
+{
+	std::vector<uint32_t> candidates;
+	for (const uint64_t key : GetDeleteKeys(word))
+	{
+		const auto entry = deletes_.find(key);
+		if (entry != deletes_.end())
+		{
+			candidates.insert(candidates.end(), entry->second.begin(), entry->second.end());
+		}
+	}
+	std::sort(candidates.begin(), candidates.end());
+
+	//(shared delete count, term id); a term close to the word shares more of its deletes
+	std::vector<std::pair<size_t, uint32_t>> ranked_candidates;
+	for (auto it = candidates.begin(); it != candidates.end();)
+	{
+		const auto next = std::upper_bound(it, candidates.end(), *it);
+		ranked_candidates.emplace_back(static_cast<size_t>(next - it), *it);
+		it = next;
+	}
+	if (ranked_candidates.size() > options_.max_verified_count)
+	{
+		const auto by_shared_count = [](const auto& lhs, const auto& rhs)
+			{ return lhs.first > rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second); };
+		std::nth_element(ranked_candidates.begin(), ranked_candidates.begin() + options_.max_verified_count, ranked_candidates.end(), by_shared_count);
+		ranked_candidates.resize(options_.max_verified_count);
+		std::sort(ranked_candidates.begin(), ranked_candidates.end(), [](const auto& lhs, const auto& rhs)
+			{ return lhs.second < rhs.second; });
+	}
+
+	//shared deletes only bound the distance of the prefixes (and hashes may collide), so every candidate is verified
+	std::vector<std::pair<uint32_t, int>> matches;
+	for (const auto& [_, term_id] : ranked_candidates)
+	{
+		const int distance = ComputeEditDistance(word, terms[term_id], options_.max_edit_distance);
+		if (distance <= options_.max_edit_distance)
+		{
+			matches.emplace_back(term_id, distance);
+		}
+	}
+	std::stable_sort(matches.begin(), matches.end(), [](const auto& lhs, const auto& rhs)
+		{ return lhs.second < rhs.second; });
+	return matches;
+}
+
+size_t FuzzyIndex::GetByteSize() const
+{
+	return deletes_.bucket_count() * sizeof(void*)
+		+ deletes_.size() * (sizeof(void*) + sizeof(std::pair<const uint64_t, std::vector<uint32_t>>))
+		+ entry_count_ * sizeof(uint32_t);
+}
+
+int FuzzyIndex::ComputeEditDistance(std::string_view lhs, std::string_view rhs, int max_distance)
+{
+	const int lhs_size = static_cast<int>(lhs.size());
+	const int rhs_size = static_cast<int>(rhs.size());
+	if (std::abs(lhs_size - rhs_size) > max_distance)
+	{
+		return max_distance + 1;
+	}
+
+	//three rows in one buffer
+	std::vector<int> rows(3 * (rhs_size + 1));
+	int* before_previous = rows.data();
+	int* previous = before_previous + rhs_size + 1;
+	int* current = previous + rhs_size + 1;
+	std::iota(previous, previous + rhs_size + 1, 0);
+	for (int i = 1; i <= lhs_size; ++i)
+	{
+		current[0] = i;
+		int row_min = current[0];
+		for (int j = 1; j <= rhs_size; ++j)
+		{
+			const int cost = lhs[i - 1] == rhs[j - 1] ? 0 : 1;
+			current[j] = std::min({ previous[j] + 1, current[j - 1] + 1, previous[j - 1] + cost });
+			if (i > 1 && j > 1 && lhs[i - 1] == rhs[j - 2] && lhs[i - 2] == rhs[j - 1])
+			{
+				current[j] = std::min(current[j], before_previous[j - 2] + 1);
+			}
+			row_min = std::min(row_min, current[j]);
+		}
+		if (row_min > max_distance)
+		{
+			return max_distance + 1;
+		}
+		std::swap(before_previous, previous);
+		std::swap(previous, current);
+	}
+	return std::min(previous[rhs_size], max_distance + 1);
+}
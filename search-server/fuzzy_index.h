@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct FuzzyMatchingOptions {
+	int max_edit_distance = 2;
+	//only deletes of the first prefix_length characters are indexed, which bounds the entries per term
+	size_t prefix_length = 7;
+	size_t max_expansion_count = 4;
+	//candidates sharing the most deletes with a word are verified first, and no more than this many
+	size_t max_verified_count = 64;
+};
+
+//symmetric delete index over the term dictionary: a term and a query word within the edit distance share a delete
+class FuzzyIndex {
+public:
+	explicit FuzzyIndex(const FuzzyMatchingOptions& options);
+
+	const FuzzyMatchingOptions& GetOptions() const;
+
+	void AddTerm(uint32_t term_id, std::string_view term);
+
+	void RemoveTerm(uint32_t term_id, std::string_view term);
+
+	//(term id, edit distance) of the dictionary terms within max_edit_distance of word among the verified candidates, closest first
+	std::vector<std::pair<uint32_t, int>> Lookup(std::string_view word, const std::vector<std::string_view>& terms) const;
+
+	size_t GetByteSize() const;
+
+	//optimal string alignment distance, or max_distance + 1 once it is known to be larger
+	static int ComputeEditDistance(std::string_view lhs, std::string_view rhs, int max_distance);
+
+private:
+	const FuzzyMatchingOptions options_;
+	std::unordered_map<uint64_t, std::vector<uint32_t>> deletes_;
+	size_t entry_count_ = 0;
+
+	std::vector<uint64_t> GetDeleteKeys(std::string_view word) const;
+};
@@ -0,0 +1,49 @@
+#include "index_stats.h"
+
+size_t IndexStats::TotalBytes() const
+{
+	return storage_bytes + inverted_index_bytes + forward_index_bytes + positions_bytes + fuzzy_index_bytes + dictionary_bytes + documents_bytes;
+}
+
+size_t GetPostingHistogramBucket(size_t posting_length)
+{
+	size_t bucket = 0;
+	while (posting_length > 1 && bucket + 1 < POSTING_HISTOGRAM_SIZE)
+	{
+		posting_length >>= 1;
+		++bucket;
+	}
+	return bucket;
+}
+
+std::ostream& operator<<(std::ostream& output, const IndexStats& stats)
+{
+	using namespace std;
+	output << "{ documents = "s << stats.document_count
+		<< ", terms = "s << stats.term_count
+		<< ", dictionary_terms = "s << stats.dictionary_term_count
+		<< ", postings = "s << stats.posting_count
+		<< ", storage_bytes = "s << stats.storage_bytes
+		<< ", dead_storage_bytes = "s << stats.dead_storage_bytes
+		<< ", inverted_index_bytes = "s << stats.inverted_index_bytes
+		<< ", forward_index_bytes = "s << stats.forward_index_bytes
+		<< ", positions_bytes = "s << stats.positions_bytes
+		<< ", fuzzy_index_bytes = "s << stats.fuzzy_index_bytes
+		<< ", dictionary_bytes = "s << stats.dictionary_bytes
+		<< ", documents_bytes = "s << stats.documents_bytes
+		<< ", estimated_allocations = "s << stats.estimated_allocation_count
+		<< ", posting_lengths = ["s;
+
+	bool is_first = true;
+	for (size_t bucket = 0; bucket < POSTING_HISTOGRAM_SIZE; ++bucket)
+	{
+		if (stats.posting_length_histogram[bucket] == 0)
+		{
+			continue;
+		}
+		output << (is_first ? ""s : ", "s) << (size_t{ 1 } << bucket) << ": "s << stats.posting_length_histogram[bucket];
+		is_first = false;
+	}
+	output << "] }"s;
+	return output;
+}
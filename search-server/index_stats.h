@@ -0,0 +1,35 @@
+#pragma once
+#include <array>
+#include <iostream>
+
+const static size_t POSTING_HISTOGRAM_SIZE = 32;
+
+struct IndexStats {
+	size_t document_count = 0;
+	size_t term_count = 0;
+	size_t dictionary_term_count = 0;
+	size_t posting_count = 0;
+
+	//document text held by the server, or after a compaction the text of the dictionary terms; exact
+	size_t storage_bytes = 0;
+	size_t dead_storage_bytes = 0;
+	//estimates: element sizes times capacities plus an assumed per-node overhead of the standard containers,
+	//allocator headers and padding are not counted
+	size_t inverted_index_bytes = 0;
+	size_t forward_index_bytes = 0;
+	size_t positions_bytes = 0;
+	size_t fuzzy_index_bytes = 0;
+	size_t dictionary_bytes = 0;
+	size_t documents_bytes = 0;
+	//estimate of the live heap blocks, assuming one block per container node or vector buffer
+	size_t estimated_allocation_count = 0;
+
+	//posting_length_histogram[i] - number of posting lists with length in [2^i, 2^(i+1))
+	std::array<size_t, POSTING_HISTOGRAM_SIZE> posting_length_histogram{};
+
+	size_t TotalBytes() const;
+};
+
+size_t GetPostingHistogramBucket(size_t posting_length);
+
+std::ostream& operator<<(std::ostream&, const IndexStats&);
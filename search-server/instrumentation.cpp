@@ -0,0 +1,277 @@
+#include "instrumentation.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct ThreadMetrics {
+	std::array<LatencyHistogram, STAGE_COUNT> stages;
+	std::array<std::atomic<uint64_t>, COUNTER_COUNT> counters{};
+};
+
+static std::mutex metrics_registry_mutex;
+static std::vector<std::unique_ptr<ThreadMetrics>> metrics_registry;
+//slots of exited threads, zeroed; their samples are kept in retired_metrics
+static std::vector<ThreadMetrics*> free_metrics;
+static MetricsSnapshot retired_metrics;
+
+static void AddThreadMetrics(MetricsSnapshot& snapshot, const ThreadMetrics& thread_metrics)
+{
+	for (size_t stage = 0; stage < STAGE_COUNT; ++stage)
+	{
+		snapshot.stages[stage].Merge(thread_metrics.stages[stage].Snapshot());
+	}
+	for (size_t counter = 0; counter < COUNTER_COUNT; ++counter)
+	{
+		snapshot.counters[counter] += thread_metrics.counters[counter].load(std::memory_order_relaxed);
+	}
+}
+
+static void ResetThreadMetrics(ThreadMetrics& thread_metrics)
+{
+	for (auto& histogram : thread_metrics.stages)
+	{
+		histogram.Reset();
+	}
+	for (auto& counter : thread_metrics.counters)
+	{
+		counter.store(0, std::memory_order_relaxed);
+	}
+}
+
+//hands the slot back when its thread exits, so short-lived threads do not grow the registry
+class ThreadMetricsSlot {
+public:
+	~ThreadMetricsSlot()
+	{
+		if (metrics_ == nullptr)
+		{
+			return;
+		}
+		std::lock_guard guard(metrics_registry_mutex);
+		AddThreadMetrics(retired_metrics, *metrics_);
+		ResetThreadMetrics(*metrics_);
+		free_metrics.push_back(metrics_);
+	}
+
+	ThreadMetrics& Get()
+	{
+		if (metrics_ == nullptr)
+		{
+			std::lock_guard guard(metrics_registry_mutex);
+			if (free_metrics.empty())
+			{
+				metrics_registry.push_back(std::make_unique<ThreadMetrics>());
+				metrics_ = metrics_registry.back().get();
+			}
+			else
+			{
+				metrics_ = free_metrics.back();
+				free_metrics.pop_back();
+			}
+		}
+		return *metrics_;
+	}
+
+private:
+	ThreadMetrics* metrics_ = nullptr;
+};
+
+static ThreadMetrics& GetThreadMetrics()
+{
+	thread_local ThreadMetricsSlot thread_metrics;
+	return thread_metrics.Get();
+}
+
+static int GetHighestBit(uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return 63 - __builtin_clzll(value);
+#else
+	int bit = 0;
+	while (value >>= 1)
+	{
+		++bit;
+	}
+	return bit;
+#endif
+}
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value)
+{
+	if (value < HISTOGRAM_SUB_BUCKET_COUNT)
+	{
+		return static_cast<size_t>(value);
+	}
+
+	const int shift = GetHighestBit(value) - static_cast<int>(HISTOGRAM_SUB_BUCKET_BITS);
+	const size_t group = static_cast<size_t>(shift) + 1;
+	const size_t sub_bucket = static_cast<size_t>(value >> shift) & (HISTOGRAM_SUB_BUCKET_COUNT - 1);
+	return group * HISTOGRAM_SUB_BUCKET_COUNT + sub_bucket;
+}
+
+uint64_t LatencyHistogram::GetBucketValue(size_t index)
+{
+	const size_t group = index / HISTOGRAM_SUB_BUCKET_COUNT;
+	const uint64_t sub_bucket = index % HISTOGRAM_SUB_BUCKET_COUNT;
+	if (group == 0)
+	{
+		return sub_bucket;
+	}
+	return (HISTOGRAM_SUB_BUCKET_COUNT + sub_bucket) << (group - 1);
+}
+
+HistogramSnapshot LatencyHistogram::Snapshot() const
+{
+	HistogramSnapshot snapshot;
+	for (size_t i = 0; i < HISTOGRAM_BUCKET_COUNT; ++i)
+	{
+		snapshot.counts[i] = counts_[i].load(std::memory_order_relaxed);
+	}
+	snapshot.total_count = total_count_.load(std::memory_order_relaxed);
+	snapshot.total_value = total_value_.load(std::memory_order_relaxed);
+	snapshot.max_value = max_value_.load(std::memory_order_relaxed);
+	return snapshot;
+}
+
+void LatencyHistogram::Reset()
+{
+	for (auto& count : counts_)
+	{
+		count.store(0, std::memory_order_relaxed);
+	}
+	total_count_.store(0, std::memory_order_relaxed);
+	total_value_.store(0, std::memory_order_relaxed);
+	max_value_.store(0, std::memory_order_relaxed);
+}
+
+void HistogramSnapshot::Merge(const HistogramSnapshot& other)
+{
+	for (size_t i = 0; i < HISTOGRAM_BUCKET_COUNT; ++i)
+	{
+		counts[i] += other.counts[i];
+	}
+	total_count += other.total_count;
+	total_value += other.total_value;
+	max_value = std::max(max_value, other.max_value);
+}
+
+uint64_t HistogramSnapshot::ValueAtPercentile(double percentile) const
+{
+	uint64_t bucket_total = 0;
+	for (const uint64_t count : counts)
+	{
+		bucket_total += count;
+	}
+	if (bucket_total == 0)
+	{
+		return 0;
+	}
+
+	const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(percentile / 100.0 * bucket_total + 0.5));
+	uint64_t seen = 0;
+	for (size_t i = 0; i < HISTOGRAM_BUCKET_COUNT; ++i)
+	{
+		seen += counts[i];
+		if (seen >= rank)
+		{
+			return std::min(LatencyHistogram::GetBucketValue(i), max_value);
+		}
+	}
+	return max_value;
+}
+
+double HistogramSnapshot::Mean() const
+{
+	return total_count == 0 ? 0.0 : static_cast<double>(total_value) / total_count;
+}
+
+void RecordStageLatency(Stage stage, uint64_t nanoseconds)
+{
+	GetThreadMetrics().stages[static_cast<size_t>(stage)].Record(nanoseconds);
+}
+
+void AddMetricsCounter(Counter counter, uint64_t value)
+{
+	std::atomic<uint64_t>& target = GetThreadMetrics().counters[static_cast<size_t>(counter)];
+	target.store(target.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+MetricsSnapshot TakeMetricsSnapshot()
+{
+	std::lock_guard guard(metrics_registry_mutex);
+	MetricsSnapshot snapshot = retired_metrics;
+	for (const auto& thread_metrics : metrics_registry)
+	{
+		AddThreadMetrics(snapshot, *thread_metrics);
+	}
+	return snapshot;
+}
+
+//not synchronized with writers: samples recorded during the reset may survive it
+void ResetMetrics()
+{
+	std::lock_guard guard(metrics_registry_mutex);
+	retired_metrics = MetricsSnapshot();
+	for (const auto& thread_metrics : metrics_registry)
+	{
+		ResetThreadMetrics(*thread_metrics);
+	}
+}
+
+const char* GetStageName(Stage stage)
+{
+	switch (stage)
+	{
+	case Stage::PARSE:
+		return "parse";
+	case Stage::POSTINGS_SCAN:
+		return "postings_scan";
+	case Stage::MINUS_FILTER:
+		return "minus_filter";
+	case Stage::SORT:
+		return "sort";
+	case Stage::MATCH:
+		return "match";
+	default:
+		return "unknown";
+	}
+}
+
+const char* GetCounterName(Counter counter)
+{
+	switch (counter)
+	{
+	case Counter::POSTINGS_SCANNED:
+		return "postings_scanned";
+	case Counter::DOCUMENTS_SCORED:
+		return "documents_scored";
+	default:
+		return "unknown";
+	}
+}
+
+void ExportMetrics(std::ostream& output, const MetricsSnapshot& snapshot)
+{
+	using namespace std;
+	output << "{\"stages\":{"s;
+	for (size_t stage = 0; stage < STAGE_COUNT; ++stage)
+	{
+		const HistogramSnapshot& histogram = snapshot.stages[stage];
+		output << (stage == 0 ? ""s : ","s) << '"' << GetStageName(static_cast<Stage>(stage)) << "\":{"s
+			<< "\"count\":"s << histogram.total_count
+			<< ",\"mean_ns\":"s << histogram.Mean()
+			<< ",\"p50_ns\":"s << histogram.ValueAtPercentile(50)
+			<< ",\"p90_ns\":"s << histogram.ValueAtPercentile(90)
+			<< ",\"p99_ns\":"s << histogram.ValueAtPercentile(99)
+			<< ",\"p999_ns\":"s << histogram.ValueAtPercentile(99.9)
+			<< ",\"max_ns\":"s << histogram.max_value << '}';
+	}
+	output << "},\"counters\":{"s;
+	for (size_t counter = 0; counter < COUNTER_COUNT; ++counter)
+	{
+		output << (counter == 0 ? ""s : ","s) << '"' << GetCounterName(static_cast<Counter>(counter)) << "\":"s << snapshot.counters[counter];
+	}
+	output << "}}"s;
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+//define SEARCH_SERVER_DISABLE_INSTRUMENTATION to compile all probes out
+
+#define INSTRUMENT_CONCAT_INTERNAL(X, Y) X##Y
+#define INSTRUMENT_CONCAT(X, Y) INSTRUMENT_CONCAT_INTERNAL(X, Y)
+#define UNIQUE_VAR_NAME_INSTRUMENT INSTRUMENT_CONCAT(stageTimer, __LINE__)
+
+#ifndef SEARCH_SERVER_DISABLE_INSTRUMENTATION
+#define INSTRUMENT_STAGE(stage) StageTimer UNIQUE_VAR_NAME_INSTRUMENT(stage)
+#define INSTRUMENT_COUNT(counter, value) AddMetricsCounter(counter, value)
+#else
+#define INSTRUMENT_STAGE(stage) ((void)0)
+#define INSTRUMENT_COUNT(counter, value) ((void)0)
+#endif
+
+enum class Stage {
+	PARSE,
+	POSTINGS_SCAN,
+	MINUS_FILTER,
+	SORT,
+	MATCH,
+	COUNT
+};
+
+enum class Counter {
+	POSTINGS_SCANNED,
+	DOCUMENTS_SCORED,
+	COUNT
+};
+
+const static size_t STAGE_COUNT = static_cast<size_t>(Stage::COUNT);
+const static size_t COUNTER_COUNT = static_cast<size_t>(Counter::COUNT);
+
+//log-linear buckets: 16 linear sub-buckets per power of two, relative error below 1/16
+const static size_t HISTOGRAM_SUB_BUCKET_BITS = 4;
+const static size_t HISTOGRAM_SUB_BUCKET_COUNT = size_t{ 1 } << HISTOGRAM_SUB_BUCKET_BITS;
+const static size_t HISTOGRAM_BUCKET_COUNT = (64 - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_SUB_BUCKET_COUNT;
+
+struct HistogramSnapshot {
+	std::array<uint64_t, HISTOGRAM_BUCKET_COUNT> counts{};
+	uint64_t total_count = 0;
+	uint64_t total_value = 0;
+	uint64_t max_value = 0;
+
+	void Merge(const HistogramSnapshot&);
+
+	uint64_t ValueAtPercentile(double percentile) const;
+
+	double Mean() const;
+};
+
+//single writer (the owning thread), any number of concurrent readers
+class LatencyHistogram {
+public:
+	static size_t GetBucketIndex(uint64_t value);
+	static uint64_t GetBucketValue(size_t index);
+
+	void Record(uint64_t value)
+	{
+		Increment(counts_[GetBucketIndex(value)], 1);
+		Increment(total_count_, 1);
+		Increment(total_value_, value);
+		if (value > max_value_.load(std::memory_order_relaxed))
+		{
+			max_value_.store(value, std::memory_order_relaxed);
+		}
+	}
+
+	HistogramSnapshot Snapshot() const;
+
+	void Reset();
+
+private:
+	std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKET_COUNT> counts_{};
+	std::atomic<uint64_t> total_count_{ 0 };
+	std::atomic<uint64_t> total_value_{ 0 };
+	std::atomic<uint64_t> max_value_{ 0 };
+
+	static void Increment(std::atomic<uint64_t>& counter, uint64_t value)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+};
+
+struct MetricsSnapshot {
+	std::array<HistogramSnapshot, STAGE_COUNT> stages;
+	std::array<uint64_t, COUNTER_COUNT> counters{};
+};
+
+void RecordStageLatency(Stage stage, uint64_t nanoseconds);
+
+void AddMetricsCounter(Counter counter, uint64_t value);
+
+MetricsSnapshot TakeMetricsSnapshot();
+
+void ResetMetrics();
+
+void ExportMetrics(std::ostream&, const MetricsSnapshot&);
+
+const char* GetStageName(Stage);
+
+const char* GetCounterName(Counter);
+
+class StageTimer {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	explicit StageTimer(Stage stage)
+		: stage_(stage)
+	{
+	}
+
+	~StageTimer()
+	{
+		using namespace std::chrono;
+		RecordStageLatency(stage_, static_cast<uint64_t>(duration_cast<nanoseconds>(Clock::now() - start_time_).count()));
+	}
+
+private:
+	const Stage stage_;
+	const Clock::time_point start_time_ = Clock::now();
+};
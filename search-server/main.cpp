@@ -9,9 +9,50 @@
 #include "request_queue.h"
 #include "read_input_functions.h"
 #include "process_queries.h"
+#include "benchmark.h"
+#include "test_example_functions.h"
 
 using namespace std;
 
-int main() 
+static void PrintUsage(ostream& output)
 {
-}
\ No newline at end of file
+	output << "Usage: search_server test"s << endl
+		<< "       search_server benchmark|numa-benchmark [--documents N] [--vocabulary N] [--document-length N] [--queries N]"s << endl
+		<< "           [--query-length N] [--removes N] [--near-duplicates N] [--simulate-nodes N] [--zipf X] [--seed N]"s << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1 && argv[1] == "test"s)
+	{
+		TestSearchServer();
+		return 0;
+	}
+	if (argc < 2 || (argv[1] != "benchmark"s && argv[1] != "numa-benchmark"s))
+	{
+		PrintUsage(cerr);
+		return 1;
+	}
+
+	BenchmarkConfig config;
+	try
+	{
+		config = ParseBenchmarkConfig(vector<string>(argv + 2, argv + argc));
+	}
+	catch (const exception& error)
+	{
+		cerr << "Invalid benchmark options: "s << error.what() << endl;
+		PrintUsage(cerr);
+		return 1;
+	}
+
+	if (argv[1] == "benchmark"s)
+	{
+		RunBenchmark(config, cout);
+	}
+	else
+	{
+		RunNumaBenchmark(config, cout);
+	}
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include "near_duplicates.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+using namespace std::literals;
+
+static uint64_t MixHash(uint64_t hash)
+{
+	hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+	hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+	return hash ^ (hash >> 31);
+}
+
+static uint64_t HashWord(std::string_view word)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (const char c : word)
+	{
+		hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+	}
+	return MixHash(hash);
+}
+
+NearDuplicateDetector::NearDuplicateDetector(const NearDuplicateOptions& options)
+	: options_(options), bands_(options.band_count)
+{
+	if (options.band_count == 0 || options.rows_per_band == 0)
+	{
+		throw std::invalid_argument("Near duplicate sketch must not be empty"s);
+	}
+
+	seeds_.resize(options.band_count * options.rows_per_band);
+	uint64_t seed = 0x9e3779b97f4a7c15ull;
+	for (uint64_t& value : seeds_)
+	{
+		seed += 0x9e3779b97f4a7c15ull;
+		value = MixHash(seed);
+	}
+}
+
+const NearDuplicateOptions& NearDuplicateDetector::GetOptions() const
+{
+	return options_;
+}
+
+NearDuplicateDetector::Sketch NearDuplicateDetector::ComputeSketch(const std::vector<std::string_view>& words) const
+{
+	Sketch sketch(seeds_.size(), std::numeric_limits<uint64_t>::max());
+	for (const std::string_view word : words)
+	{
+		const uint64_t word_hash = HashWord(word);
+		for (size_t i = 0; i < seeds_.size(); ++i)
+		{
+			sketch[i] = std::min(sketch[i], MixHash(word_hash ^ seeds_[i]));
+		}
+	}
+	return sketch;
+}
+
+size_t NearDuplicateDetector::GetSketchSize() const
+{
+	return seeds_.size();
+}
+
+bool NearDuplicateDetector::IsEmptySet(const Sketch& sketch)
+{
+	return std::all_of(sketch.begin(), sketch.end(), [](uint64_t value)
+		{ return value == std::numeric_limits<uint64_t>::max(); });
+}
+
+uint64_t NearDuplicateDetector::GetBandKey(const Sketch& sketch, size_t band) const
+{
+	uint64_t key = band;
+	for (size_t row = 0; row < options_.rows_per_band; ++row)
+	{
+		key = MixHash(key ^ sketch[band * options_.rows_per_band + row]);
+	}
+	return key;
+}
+
+double NearDuplicateDetector::EstimateSimilarity(const Sketch& lhs, const Sketch& rhs)
+{
+	if (lhs.empty() || lhs.size() != rhs.size())
+	{
+		return 0.0;
+	}
+
+	size_t equal = 0;
+	for (size_t i = 0; i < lhs.size(); ++i)
+	{
+		equal += lhs[i] == rhs[i];
+	}
+	return static_cast<double>(equal) / lhs.size();
+}
+
+std::vector<std::pair<int, double>> NearDuplicateDetector::FindSimilar(const Sketch& sketch, double threshold, int excluded_id) const
+{
+	if (sketch.size() != seeds_.size())
+	{
+		throw std::invalid_argument("Sketch size does not match the detector"s);
+	}
+	if (IsEmptySet(sketch))
+	{
+		return {};
+	}
+	std::vector<int> candidates;
+	for (size_t band = 0; band < bands_.size(); ++band)
+	{
+		const auto bucket = bands_[band].find(GetBandKey(sketch, band));
+		if (bucket != bands_[band].end())
+		{
+			candidates.insert(candidates.end(), bucket->second.begin(), bucket->second.end());
+		}
+	}
+	std::sort(candidates.begin(), candidates.end());
+	candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+	std::vector<std::pair<int, double>> similar;
+	for (const int document_id : candidates)
+	{
+		if (document_id == excluded_id)
+		{
+			continue;
+		}
+		const double similarity = EstimateSimilarity(sketch, sketches_.at(document_id));
+		if (similarity >= threshold)
+		{
+			similar.emplace_back(document_id, similarity);
+		}
+	}
+
+	std::sort(similar.begin(), similar.end(), [](const auto& lhs, const auto& rhs)
+		{
+			return lhs.second > rhs.second || (lhs.second == rhs.second && lhs.first < rhs.first);
+		});
+	return similar;
+}
+
+std::vector<std::pair<int, double>> NearDuplicateDetector::FindSimilar(int document_id) const
+{
+	const auto sketch = sketches_.find(document_id);
+	if (sketch == sketches_.end())
+	{
+		return {};
+	}
+	return FindSimilar(sketch->second, options_.threshold, document_id);
+}
+
+void NearDuplicateDetector::Add(int document_id, Sketch sketch)
+{
+	if (sketch.size() != seeds_.size())
+	{
+		throw std::invalid_argument("Sketch size does not match the detector"s);
+	}
+	if (IsEmptySet(sketch))
+	{
+		return;
+	}
+	for (size_t band = 0; band < bands_.size(); ++band)
+	{
+		bands_[band][GetBandKey(sketch, band)].push_back(document_id);
+	}
+	sketches_[document_id] = std::move(sketch);
+}
+
+void NearDuplicateDetector::Remove(int document_id)
+{
+	const auto sketch = sketches_.find(document_id);
+	if (sketch == sketches_.end())
+	{
+		return;
+	}
+
+	for (size_t band = 0; band < bands_.size(); ++band)
+	{
+		const auto bucket = bands_[band].find(GetBandKey(sketch->second, band));
+		std::vector<int>& ids = bucket->second;
+		ids.erase(std::remove(ids.begin(), ids.end(), document_id), ids.end());
+		if (ids.empty())
+		{
+			bands_[band].erase(bucket);
+		}
+	}
+	sketches_.erase(sketch);
+}
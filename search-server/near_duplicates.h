@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct NearDuplicateOptions {
+	size_t band_count = 16;
+	size_t rows_per_band = 4;
+	double threshold = 0.8;
+	bool reject = false;
+};
+
+//MinHash sketches of document word sets, indexed by LSH bands
+class NearDuplicateDetector {
+public:
+	using Sketch = std::vector<uint64_t>;
+
+	explicit NearDuplicateDetector(const NearDuplicateOptions& options);
+
+	const NearDuplicateOptions& GetOptions() const;
+
+	//an empty word set gets a sketch of maximal values; it is never stored and has no near duplicates
+	Sketch ComputeSketch(const std::vector<std::string_view>& words) const;
+	//sketches of other sizes are rejected
+	size_t GetSketchSize() const;
+
+	//documents sharing at least one band whose estimated Jaccard similarity reaches threshold, most similar first
+	std::vector<std::pair<int, double>> FindSimilar(const Sketch& sketch, double threshold, int excluded_id = -1) const;
+	std::vector<std::pair<int, double>> FindSimilar(int document_id) const;
+
+	void Add(int document_id, Sketch sketch);
+
+	void Remove(int document_id);
+
+	static double EstimateSimilarity(const Sketch& lhs, const Sketch& rhs);
+
+private:
+	const NearDuplicateOptions options_;
+	std::vector<uint64_t> seeds_;
+	std::unordered_map<int, Sketch> sketches_;
+	std::vector<std::unordered_map<uint64_t, std::vector<int>>> bands_;
+
+	uint64_t GetBandKey(const Sketch& sketch, size_t band) const;
+	static bool IsEmptySet(const Sketch& sketch);
+};
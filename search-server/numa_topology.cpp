@@ -0,0 +1,125 @@
+#include "numa_topology.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std::literals;
+
+std::vector<int> ParseCpuList(const std::string& cpu_list)
+{
+	std::vector<int> cpus;
+	std::istringstream input(cpu_list);
+	std::string range;
+	while (std::getline(input, range, ','))
+	{
+		if (range.empty())
+		{
+			continue;
+		}
+		const size_t dash = range.find('-');
+		const int first = std::stoi(range.substr(0, dash));
+		const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+		if (first < 0 || last < first)
+		{
+			throw std::invalid_argument("Invalid cpu list "s + cpu_list);
+		}
+		for (int cpu = first; cpu <= last; ++cpu)
+		{
+			cpus.push_back(cpu);
+		}
+	}
+	return cpus;
+}
+
+std::vector<NumaNode> ReadNumaTopology(const std::string& sysfs_root)
+{
+	namespace fs = std::filesystem;
+	std::vector<NumaNode> nodes;
+	std::error_code error;
+	for (fs::directory_iterator entry(sysfs_root, error), last; !error && entry != last; entry.increment(error))
+	{
+		const std::string name = entry->path().filename().string();
+		if (name.rfind("node"s, 0) != 0 || name.size() == 4 || !std::all_of(name.begin() + 4, name.end(), ::isdigit))
+		{
+			continue;
+		}
+		std::ifstream cpu_list_file(entry->path() / "cpulist"s);
+		std::string cpu_list;
+		std::getline(cpu_list_file, cpu_list);
+		NumaNode node{ std::stoi(name.substr(4)), ParseCpuList(cpu_list) };
+		//memory-only nodes have no cpus to run queries on
+		if (!node.cpus.empty())
+		{
+			nodes.push_back(std::move(node));
+		}
+	}
+	std::sort(nodes.begin(), nodes.end(), [](const NumaNode& lhs, const NumaNode& rhs) { return lhs.id < rhs.id; });
+
+	if (nodes.empty())
+	{
+		NumaNode node;
+		node.cpus.resize(std::max(std::thread::hardware_concurrency(), 1u));
+		std::iota(node.cpus.begin(), node.cpus.end(), 0);
+		nodes.push_back(std::move(node));
+	}
+	return nodes;
+}
+
+std::vector<NumaNode> SimulateNumaTopology(int node_count)
+{
+	if (node_count < 1)
+	{
+		throw std::invalid_argument("Simulated topology needs at least one node"s);
+	}
+	std::vector<int> cpus;
+	for (const NumaNode& node : ReadNumaTopology())
+	{
+		cpus.insert(cpus.end(), node.cpus.begin(), node.cpus.end());
+	}
+
+	std::vector<NumaNode> nodes(node_count);
+	for (int i = 0; i < node_count; ++i)
+	{
+		nodes[i].id = i;
+	}
+	for (size_t i = 0; i < std::max(cpus.size(), nodes.size()); ++i)
+	{
+		std::vector<int>& node_cpus = nodes[i % nodes.size()].cpus;
+		const int cpu = cpus[i % cpus.size()];
+		if (std::find(node_cpus.begin(), node_cpus.end(), cpu) == node_cpus.end())
+		{
+			node_cpus.push_back(cpu);
+		}
+	}
+	return nodes;
+}
+
+bool PinCurrentThread(const std::vector<int>& cpus)
+{
+#ifdef __linux__
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	for (const int cpu : cpus)
+	{
+		if (cpu < CPU_SETSIZE)
+		{
+			CPU_SET(cpu, &cpu_set);
+		}
+	}
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+	static_cast<void>(cpus);
+	return false;
+#endif
+}
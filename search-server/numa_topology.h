@@ -0,0 +1,21 @@
+#pragma once
+#include <string>
+#include <vector>
+
+struct NumaNode {
+	int id = 0;
+	std::vector<int> cpus;
+};
+
+//nodes listed under sysfs_root (node<N>/cpulist); one node holding every cpu where the directory is missing
+std::vector<NumaNode> ReadNumaTopology(const std::string& sysfs_root = "/sys/devices/system/node");
+
+//deals the cpus of the real topology round-robin into node_count nodes, to exercise replication on one-socket hosts;
+//nodes share cpus when there are fewer cpus than nodes
+std::vector<NumaNode> SimulateNumaTopology(int node_count);
+
+//"0-3,8,10-11" -> { 0, 1, 2, 3, 8, 10, 11 }
+std::vector<int> ParseCpuList(const std::string& cpu_list);
+
+//restricts the calling thread to the given cpus; false where affinity is unsupported or refused
+bool PinCurrentThread(const std::vector<int>& cpus);
@@ -0,0 +1,154 @@
+#include "query_log.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+using namespace std::literals;
+
+//the tables a thread has created, one per live log; the destructor runs at thread exit
+class QueryLog::ThreadTables {
+public:
+	~ThreadTables()
+	{
+		for (Entry& entry : entries_)
+		{
+			if (const std::shared_ptr<Shared> shared = entry.owner.lock())
+			{
+				Retire(*shared, *entry.counts);
+			}
+		}
+	}
+
+	ThreadCounts& Get(const std::shared_ptr<Shared>& shared)
+	{
+		for (const Entry& entry : entries_)
+		{
+			if (entry.shared == shared.get() && !entry.owner.expired())
+			{
+				return *entry.counts;
+			}
+		}
+		//a log destroyed since leaves an expired entry, which may share its address with a new log
+		entries_.erase(std::remove_if(entries_.begin(), entries_.end(), [](const Entry& entry)
+			{ return entry.owner.expired(); }), entries_.end());
+
+		entries_.push_back({ shared.get(), shared, std::make_unique<ThreadCounts>() });
+		std::lock_guard guard(shared->mutex);
+		shared->tables.push_back(entries_.back().counts.get());
+		return *entries_.back().counts;
+	}
+
+private:
+	struct Entry {
+		const Shared* shared;
+		std::weak_ptr<Shared> owner;
+		std::unique_ptr<ThreadCounts> counts;
+	};
+
+	std::vector<Entry> entries_;
+
+	static void Retire(Shared& shared, ThreadCounts& counts)
+	{
+		std::lock_guard guard(shared.mutex);
+		std::lock_guard counts_guard(counts.mutex);
+		for (const auto& [term, count] : counts.counts)
+		{
+			shared.retired_counts[term] += count;
+		}
+		shared.tables.erase(std::find(shared.tables.begin(), shared.tables.end(), &counts));
+	}
+};
+
+QueryLog::QueryLog()
+	: shared_(std::make_shared<Shared>())
+{
+}
+
+QueryLog::ThreadCounts& QueryLog::GetThreadCounts()
+{
+	thread_local ThreadTables thread_tables;
+	return thread_tables.Get(shared_);
+}
+
+void QueryLog::Record(const std::vector<std::string_view>& terms)
+{
+	if (terms.empty())
+	{
+		return;
+	}
+	ThreadCounts& thread_counts = GetThreadCounts();
+	std::lock_guard guard(thread_counts.mutex);
+	for (const std::string_view term : terms)
+	{
+		const auto entry = thread_counts.counts.find(term);
+		if (entry != thread_counts.counts.end())
+		{
+			++entry->second;
+		}
+		else
+		{
+			thread_counts.counts.emplace(term, 1);
+		}
+	}
+}
+
+std::vector<HotTerm> QueryLog::GetHotTerms(size_t max_count) const
+{
+	Counts counts;
+	{
+		std::lock_guard guard(shared_->mutex);
+		counts = shared_->retired_counts;
+		for (ThreadCounts* table : shared_->tables)
+		{
+			std::lock_guard table_guard(table->mutex);
+			for (const auto& [term, count] : table->counts)
+			{
+				counts[term] += count;
+			}
+		}
+	}
+
+	std::vector<HotTerm> hot_terms;
+	hot_terms.reserve(counts.size());
+	for (auto& [term, count] : counts)
+	{
+		hot_terms.push_back({ term, count });
+	}
+	const auto last = hot_terms.begin() + std::min(max_count, hot_terms.size());
+	//counts is sorted by term, so a stable order by count keeps ties in term order
+	std::stable_sort(hot_terms.begin(), hot_terms.end(), [](const HotTerm& lhs, const HotTerm& rhs)
+		{ return lhs.count > rhs.count; });
+	hot_terms.erase(last, hot_terms.end());
+	return hot_terms;
+}
+
+void WriteQueryLog(std::ostream& output, const std::vector<HotTerm>& hot_terms)
+{
+	for (const HotTerm& hot_term : hot_terms)
+	{
+		output << hot_term.term << ' ' << hot_term.count << '\n';
+	}
+}
+
+std::vector<HotTerm> ReadQueryLog(std::istream& input)
+{
+	std::vector<HotTerm> hot_terms;
+	std::string line;
+	while (std::getline(input, line))
+	{
+		if (line.empty())
+		{
+			continue;
+		}
+		std::istringstream line_input(line);
+		HotTerm hot_term;
+		if (!(line_input >> hot_term.term >> hot_term.count) || !(line_input >> std::ws).eof())
+		{
+			throw std::invalid_argument("Malformed query log line: "s + line);
+		}
+		hot_terms.push_back(std::move(hot_term));
+	}
+	return hot_terms;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct HotTerm {
+	std::string term;
+	uint64_t count = 0;
+};
+
+struct WarmupResult {
+	size_t term_count = 0;
+	size_t posting_count = 0;
+	//sum over the data read, returned so the reads cannot be optimised away
+	uint64_t checksum = 0;
+};
+
+//term counts of logged queries; every thread counts into its own table, so recording never waits on another
+//query, and GetHotTerms merges the tables. A thread's table is folded into the log when the thread exits
+class QueryLog {
+public:
+	QueryLog();
+
+	QueryLog(const QueryLog&) = delete;
+	QueryLog& operator=(const QueryLog&) = delete;
+
+	void Record(const std::vector<std::string_view>& terms);
+
+	//most frequent first, ties in term order
+	std::vector<HotTerm> GetHotTerms(size_t max_count) const;
+
+private:
+	using Counts = std::map<std::string, uint64_t, std::less<>>;
+
+	struct ThreadCounts {
+		//taken by the owning thread once per query and by GetHotTerms, so it is practically uncontended
+		std::mutex mutex;
+		Counts counts;
+	};
+
+	struct Shared {
+		std::mutex mutex;
+		std::vector<ThreadCounts*> tables;
+		Counts retired_counts;
+	};
+
+	class ThreadTables;
+
+	std::shared_ptr<Shared> shared_;
+
+	ThreadCounts& GetThreadCounts();
+};
+
+//one "term count" line per entry; terms never contain spaces, so the log needs no escaping
+void WriteQueryLog(std::ostream& output, const std::vector<HotTerm>& hot_terms);
+
+std::vector<HotTerm> ReadQueryLog(std::istream& input);
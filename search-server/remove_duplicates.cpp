@@ -1 +1,81 @@
+#include "remove_duplicates.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <execution>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+using WordSetSignature = std::pair<uint64_t, uint64_t>;
+
+struct WordSetSignatureHasher {
+	size_t operator()(const WordSetSignature& signature) const
+	{
+		return static_cast<size_t>(signature.first ^ (signature.second * 0x9e3779b97f4a7c15ull));
+	}
+};
+
+static uint64_t HashWord(std::string_view word, uint64_t seed)
+{
+	uint64_t hash = seed;
+	for (const char c : word)
+	{
+		hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+	}
+	hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+	hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+	return hash ^ (hash >> 31);
+}
+
+//sum of per-word hashes does not depend on word order, so the set never has to be sorted
+static WordSetSignature ComputeSignature(const SearchServer& search_server, int document_id)
+{
+	WordSetSignature signature{ 0, 0 };
+	for (const auto [word, _] : search_server.GetWordFrequencies(document_id))
+	{
+		signature.first += HashWord(word, 0xcbf29ce484222325ull);
+		signature.second += HashWord(word, 0x84222325cbf29ce4ull);
+	}
+	return signature;
+}
+
+template <typename ExecutionPolicy>
+static std::vector<int> CommonOfRemoveDuplicates(const ExecutionPolicy& policy, SearchServer& search_server)
+{
+	const std::vector<int> document_ids(search_server.begin(), search_server.end());
+
+	std::vector<WordSetSignature> signatures(document_ids.size());
+	std::transform(policy, document_ids.begin(), document_ids.end(), signatures.begin(), [&search_server](int document_id)
+		{ return ComputeSignature(search_server, document_id); });
+
+	//ids come in ascending order, so the first document seen with a signature is the one to keep
+	std::unordered_map<WordSetSignature, int, WordSetSignatureHasher> originals;
+	originals.reserve(document_ids.size());
+	std::vector<int> duplicates;
+	for (size_t i = 0; i < document_ids.size(); ++i)
+	{
+		if (!originals.emplace(signatures[i], document_ids[i]).second)
+		{
+			duplicates.push_back(document_ids[i]);
+		}
+	}
+
+	search_server.RemoveDocuments(policy, duplicates);
+	return duplicates;
+}
+
+std::vector<int> RemoveDuplicates(SearchServer& search_server)
+{
+	return CommonOfRemoveDuplicates(std::execution::par, search_server);
+}
+
+std::vector<int> RemoveDuplicates(const std::execution::sequenced_policy& policy, SearchServer& search_server)
+{
+	return CommonOfRemoveDuplicates(policy, search_server);
+}
+
+std::vector<int> RemoveDuplicates(const std::execution::parallel_policy& policy, SearchServer& search_server)
+{
+	return CommonOfRemoveDuplicates(policy, search_server);
+}
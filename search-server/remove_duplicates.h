@@ -1 +1,11 @@
-#pragma once
\ No newline at end of file
+#pragma once
+#include <execution>
+#include <vector>
+
+#include "search_server.h"
+
+//removes documents whose word sets repeat a document with a lower id, returns the removed ids
+std::vector<int> RemoveDuplicates(SearchServer& search_server);
+//the policy of the removal and of the signature computation
+std::vector<int> RemoveDuplicates(const std::execution::sequenced_policy&, SearchServer& search_server);
+std::vector<int> RemoveDuplicates(const std::execution::parallel_policy&, SearchServer& search_server);
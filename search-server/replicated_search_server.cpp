@@ -0,0 +1,211 @@
+#include "replicated_search_server.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+//the queries of one ProcessQueries call
+struct ReplicatedSearchServer::Batch {
+	const std::vector<std::string>& queries;
+	std::vector<std::vector<Document>>& results;
+	size_t node_count;
+	std::atomic<size_t> next_query = 0;
+	//the first exception a query threw, guarded by the pool mutex
+	std::exception_ptr error;
+};
+
+struct ReplicatedSearchServer::WorkerPool {
+	//one batch at a time is handed to the workers
+	std::mutex call_mutex;
+
+	std::mutex mutex;
+	std::condition_variable batch_posted;
+	std::condition_variable batch_done;
+	Batch* batch = nullptr;
+	uint64_t generation = 0;
+	size_t pending_worker_count = 0;
+	bool stopping = false;
+	std::vector<std::thread> workers;
+
+	~WorkerPool()
+	{
+		{
+			std::lock_guard guard(mutex);
+			stopping = true;
+		}
+		batch_posted.notify_all();
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+	}
+};
+
+static void JoinAll(std::vector<std::thread>& threads)
+{
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+ReplicatedSearchServer::ReplicatedSearchServer(std::vector<NumaNode> nodes, const std::function<std::unique_ptr<SearchServer>()>& build)
+	: nodes_(std::move(nodes)), replicas_(nodes_.size())
+{
+	using namespace std::literals;
+	if (nodes_.empty())
+	{
+		throw std::invalid_argument("Replicated server needs at least one node"s);
+	}
+
+	std::vector<std::thread> builders;
+	std::vector<std::exception_ptr> errors(nodes_.size());
+	try
+	{
+		for (size_t i = 0; i < nodes_.size(); ++i)
+		{
+			builders.emplace_back([this, &build, &errors, i]
+				{
+					PinCurrentThread(nodes_[i].cpus);
+					try
+					{
+						replicas_[i] = build();
+					}
+					catch (...)
+					{
+						errors[i] = std::current_exception();
+					}
+				});
+		}
+	}
+	catch (...)
+	{
+		//a thread that failed to start must not leave the started ones joinable
+		JoinAll(builders);
+		throw;
+	}
+	JoinAll(builders);
+	for (const std::exception_ptr& error : errors)
+	{
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+
+	//if a worker fails to start, destroying the pool stops and joins the started ones
+	pool_ = std::make_unique<WorkerPool>();
+	for (size_t i = 0; i < nodes_.size(); ++i)
+	{
+		for (const int cpu : nodes_[i].cpus)
+		{
+			pool_->workers.emplace_back([this, i, cpu]
+				{ RunWorker(i, cpu); });
+		}
+	}
+}
+
+ReplicatedSearchServer::~ReplicatedSearchServer() = default;
+
+void ReplicatedSearchServer::RunWorker(size_t node_index, int cpu) const
+{
+	PinCurrentThread({ cpu });
+	const SearchServer& replica = *replicas_[node_index];
+	WorkerPool& pool = *pool_;
+	uint64_t generation = 0;
+	while (true)
+	{
+		Batch* batch = nullptr;
+		{
+			std::unique_lock lock(pool.mutex);
+			pool.batch_posted.wait(lock, [&pool, generation]
+				{ return pool.stopping || pool.generation != generation; });
+			if (pool.stopping)
+			{
+				return;
+			}
+			generation = pool.generation;
+			batch = pool.batch;
+		}
+
+		//workers take the next unanswered query, so a slow node does not hold back the others
+		if (node_index < batch->node_count)
+		{
+			try
+			{
+				for (size_t query = batch->next_query++; query < batch->queries.size(); query = batch->next_query++)
+				{
+					batch->results[query] = replica.FindTopDocuments(batch->queries[query]);
+				}
+			}
+			catch (...)
+			{
+				std::lock_guard guard(pool.mutex);
+				if (!batch->error)
+				{
+					batch->error = std::current_exception();
+				}
+				//the other workers stop at their next query
+				batch->next_query = batch->queries.size();
+			}
+		}
+
+		std::lock_guard guard(pool.mutex);
+		if (--pool.pending_worker_count == 0)
+		{
+			pool.batch_done.notify_all();
+		}
+	}
+}
+
+size_t ReplicatedSearchServer::GetNodeCount() const
+{
+	return nodes_.size();
+}
+
+const NumaNode& ReplicatedSearchServer::GetNode(size_t node_index) const
+{
+	return nodes_.at(node_index);
+}
+
+const SearchServer& ReplicatedSearchServer::GetReplica(size_t node_index) const
+{
+	return *replicas_.at(node_index);
+}
+
+std::vector<std::vector<Document>> ReplicatedSearchServer::ProcessQueries(const std::vector<std::string>& queries, size_t node_count) const
+{
+	using namespace std::literals;
+	if (node_count == 0 || node_count > nodes_.size())
+	{
+		throw std::out_of_range("Node count must be between 1 and the number of replicas"s);
+	}
+
+	std::vector<std::vector<Document>> results(queries.size());
+	Batch batch{ queries, results, node_count, 0, nullptr };
+	{
+		std::lock_guard call_guard(pool_->call_mutex);
+		std::unique_lock lock(pool_->mutex);
+		//every worker acknowledges the batch, those of nodes beyond node_count without taking queries
+		pool_->batch = &batch;
+		pool_->pending_worker_count = pool_->workers.size();
+		++pool_->generation;
+		pool_->batch_posted.notify_all();
+		pool_->batch_done.wait(lock, [this]
+			{ return pool_->pending_worker_count == 0; });
+		pool_->batch = nullptr;
+	}
+	if (batch.error)
+	{
+		std::rethrow_exception(batch.error);
+	}
+	return results;
+}
+
+std::vector<std::vector<Document>> ReplicatedSearchServer::ProcessQueries(const std::vector<std::string>& queries) const
+{
+	return ProcessQueries(queries, nodes_.size());
+}
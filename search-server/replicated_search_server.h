@@ -0,0 +1,41 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "document.h"
+#include "numa_topology.h"
+#include "search_server.h"
+
+//one read-only SearchServer per NUMA node, built by a thread pinned to that node so first-touch allocation
+//places its pages in local memory; query workers are started once, pinned to a cpu, and read the replica of its node
+class ReplicatedSearchServer {
+public:
+	//build runs once per node, concurrently, and must produce the same index every time
+	ReplicatedSearchServer(std::vector<NumaNode> nodes, const std::function<std::unique_ptr<SearchServer>()>& build);
+
+	~ReplicatedSearchServer();
+
+	size_t GetNodeCount() const;
+
+	const NumaNode& GetNode(size_t node_index) const;
+
+	const SearchServer& GetReplica(size_t node_index) const;
+
+	//FindTopDocuments for every query on the workers of the first node_count nodes, results in query order;
+	//calls run one at a time, and the first exception a query throws is rethrown once every worker is done
+	std::vector<std::vector<Document>> ProcessQueries(const std::vector<std::string>& queries, size_t node_count) const;
+	std::vector<std::vector<Document>> ProcessQueries(const std::vector<std::string>& queries) const;
+
+private:
+	struct Batch;
+	struct WorkerPool;
+
+	std::vector<NumaNode> nodes_;
+	std::vector<std::unique_ptr<SearchServer>> replicas_;
+	//declared last, so the workers are joined before the replicas they read are destroyed
+	std::unique_ptr<WorkerPool> pool_;
+
+	void RunWorker(size_t node_index, int cpu) const;
+};
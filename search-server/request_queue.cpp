@@ -1,44 +1,37 @@
 #include "request_queue.h"
 
-RequestQueue::RequestQueue(const SearchServer& search_server) :search_server_(search_server)
+RequestQueue::RequestQueue(const SearchServer& search_server, std::chrono::seconds window)
+	: search_server_(search_server), window_(window), tracker_(RequestTracker::DEFAULT_RING_CAPACITY, window)
 {
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) 
 {
-	std::vector<Document> result = search_server_.FindTopDocuments(raw_query, status);
-	CheckRequests(result.size());
-	return result;
+	return TrackRequest([&]
+		{
+			return search_server_.FindTopDocuments(raw_query, status);
+		});
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) 
 {
-	std::vector<Document> result = search_server_.FindTopDocuments(raw_query);
-	CheckRequests(result.size());
-	return result;
+	return TrackRequest([&]
+		{
+			return search_server_.FindTopDocuments(raw_query);
+		});
 }
 
 int RequestQueue::GetNoResultRequests() const 
 {
-	return null_requests_;
+	return static_cast<int>(GetStats().no_result_count);
 }
 
-void RequestQueue::CheckRequests(size_t result_size) 
+RequestStats RequestQueue::GetStats() const
 {
-	++current_time_;
-	if (result_size == 0) 
-	{
-		++null_requests_;
-	}
+	return GetStats(window_);
+}
 
-	while (!requests_.empty() && min_in_day_ <= current_time_ - requests_.front().request_time) 
-	{
-		if (requests_.front().found_docs == 0) 
-		{
-			--null_requests_;
-		}
-		
-		requests_.pop_front();
-	}
-	requests_.push_back({ current_time_, result_size });
-}
\ No newline at end of file
+RequestStats RequestQueue::GetStats(std::chrono::nanoseconds window) const
+{
+	return tracker_.GetStats(window);
+}
@@ -1,12 +1,15 @@
 #pragma once
+#include <chrono>
 #include <vector>
 #include <string>
-#include <deque>
 #include "search_server.h"
 #include "document.h"
+#include "request_tracker.h"
+
+//safe to call AddFindRequest from many threads at once
 class RequestQueue {
 public:
-	explicit RequestQueue(const SearchServer&);
+	explicit RequestQueue(const SearchServer&, std::chrono::seconds window = std::chrono::hours(24));
 
 	template <typename DocumentPredicate>
 	std::vector<Document> AddFindRequest(const std::string&, DocumentPredicate);
@@ -17,25 +20,33 @@ public:
 
 	int GetNoResultRequests() const;
 
-private:
-	struct QueryResult {
-		uint64_t request_time;
-		size_t found_docs;
-	};
+	RequestStats GetStats() const;
+	RequestStats GetStats(std::chrono::nanoseconds window) const;
 
+private:
 	const SearchServer& search_server_;
-	std::deque<QueryResult> requests_;
-	const static int min_in_day_ = 1440;
-	int null_requests_ = 0;
-	uint64_t current_time_ = 0;
+	const std::chrono::seconds window_;
+	RequestTracker tracker_;
 
-	void CheckRequests(size_t);
+	template <typename Search>
+	std::vector<Document> TrackRequest(Search search);
 };
 
+template <typename Search>
+std::vector<Document> RequestQueue::TrackRequest(Search search)
+{
+	const auto start_time = RequestTracker::Clock::now();
+	std::vector<Document> result = search();
+	const auto finish_time = RequestTracker::Clock::now();
+	tracker_.Record(finish_time, finish_time - start_time, result.size());
+	return result;
+}
+
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) 
 {
-	std::vector<Document> result = search_server_.FindTopDocuments(raw_query, document_predicate);
-	CheckRequests(result.size());
-	return result;
-}
\ No newline at end of file
+	return TrackRequest([&]
+		{
+			return search_server_.FindTopDocuments(raw_query, document_predicate);
+		});
+}
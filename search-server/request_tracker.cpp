@@ -0,0 +1,211 @@
+#include "request_tracker.h"
+
+#include <algorithm>
+#include <utility>
+
+static std::atomic<uint64_t> next_tracker_id{ 0 };
+
+const static int64_t AGGREGATE_INTERVAL_NS = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::minutes(1)).count();
+
+static int64_t ToNanoseconds(RequestTracker::Clock::time_point time)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+//the clock epoch is unspecified, so times before it are rounded down as well
+static int64_t GetInterval(int64_t time)
+{
+	return time / AGGREGATE_INTERVAL_NS - (time % AGGREGATE_INTERVAL_NS < 0 ? 1 : 0);
+}
+
+//Stats is RequestStats or an aggregate, both count requests the same way
+template <typename Stats>
+static void AddRecord(Stats& stats, uint64_t latency, uint64_t found_docs)
+{
+	++stats.request_count;
+	if (found_docs == 0)
+	{
+		++stats.no_result_count;
+	}
+	++stats.latency.counts[LatencyHistogram::GetBucketIndex(latency)];
+	++stats.latency.total_count;
+	stats.latency.total_value += latency;
+	stats.latency.max_value = std::max(stats.latency.max_value, latency);
+}
+
+//the rings a thread has created, one per live tracker; the destructor runs at thread exit
+class RequestTracker::ThreadRings {
+public:
+	~ThreadRings()
+	{
+		for (const Entry& entry : entries_)
+		{
+			if (const std::shared_ptr<State> state = entry.state.lock())
+			{
+				std::lock_guard guard(state->mutex);
+				Fold(*state, *entry.ring, entry.ring->head.load(std::memory_order_relaxed));
+				state->rings.erase(std::find_if(state->rings.begin(), state->rings.end(), [&entry](const auto& ring)
+					{ return ring.get() == entry.ring; }));
+			}
+		}
+	}
+
+	Ring& Get(uint64_t tracker_id, const std::shared_ptr<State>& state, size_t ring_capacity)
+	{
+		//tracker ids are never reused, so a destroyed tracker cannot hand its ring to a new one
+		for (const Entry& entry : entries_)
+		{
+			if (entry.tracker_id == tracker_id)
+			{
+				return *entry.ring;
+			}
+		}
+		entries_.erase(std::remove_if(entries_.begin(), entries_.end(), [](const Entry& entry)
+			{ return entry.state.expired(); }), entries_.end());
+
+		std::lock_guard guard(state->mutex);
+		state->rings.push_back(std::make_unique<Ring>(ring_capacity));
+		entries_.push_back({ tracker_id, state, state->rings.back().get() });
+		return *entries_.back().ring;
+	}
+
+private:
+	struct Entry {
+		uint64_t tracker_id;
+		std::weak_ptr<State> state;
+		Ring* ring;
+	};
+
+	std::vector<Entry> entries_;
+};
+
+RequestTracker::RequestTracker(size_t ring_capacity, std::chrono::nanoseconds retention)
+	: ring_capacity_(ring_capacity == 0 ? 1 : ring_capacity)
+	, fold_batch_size_(std::max<size_t>(1, ring_capacity_ / 4))
+	, tracker_id_(next_tracker_id++)
+	, start_time_(Clock::now())
+	, state_(std::make_shared<State>(retention))
+{
+}
+
+RequestTracker::Ring& RequestTracker::GetThreadRing()
+{
+	thread_local ThreadRings thread_rings;
+	return thread_rings.Get(tracker_id_, state_, ring_capacity_);
+}
+
+void RequestTracker::Fold(State& state, Ring& ring, uint64_t end)
+{
+	if (end <= ring.folded)
+	{
+		return;
+	}
+	const size_t capacity = ring.slots.size();
+	for (uint64_t index = ring.folded; index < end; ++index)
+	{
+		const Slot& slot = ring.slots[index % capacity];
+		const int64_t finish_time = slot.finish_time_ns.load(std::memory_order_relaxed);
+		const uint64_t latency = slot.latency_ns.load(std::memory_order_relaxed);
+		AddRecord(state.aggregates[GetInterval(finish_time)], latency, slot.found_docs.load(std::memory_order_relaxed));
+	}
+	ring.folded = end;
+
+	//a thread records in time order, so the last folded record is the newest
+	const int64_t last_finish_time = ring.slots[(end - 1) % capacity].finish_time_ns.load(std::memory_order_relaxed);
+	const int64_t oldest_interval = GetInterval(last_finish_time - state.retention.count());
+	state.aggregates.erase(state.aggregates.begin(), state.aggregates.lower_bound(oldest_interval));
+}
+
+void RequestTracker::Record(Clock::time_point finish_time, std::chrono::nanoseconds latency, size_t found_docs)
+{
+	Ring& ring = GetThreadRing();
+	const uint64_t head = ring.head.load(std::memory_order_relaxed);
+	if (head >= ring.folded + ring_capacity_)
+	{
+		std::lock_guard guard(state_->mutex);
+		Fold(*state_, ring, ring.folded + fold_batch_size_);
+	}
+	Slot& slot = ring.slots[head % ring_capacity_];
+
+	slot.sequence.store(2 * head + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.finish_time_ns.store(ToNanoseconds(finish_time), std::memory_order_relaxed);
+	slot.latency_ns.store(static_cast<uint64_t>(latency.count()), std::memory_order_relaxed);
+	slot.found_docs.store(found_docs, std::memory_order_relaxed);
+	slot.sequence.store(2 * head + 2, std::memory_order_release);
+	ring.head.store(head + 1, std::memory_order_release);
+}
+
+RequestStats RequestTracker::GetStats(std::chrono::nanoseconds window) const
+{
+	return GetStats(window, Clock::now());
+}
+
+RequestStats RequestTracker::GetStats(std::chrono::nanoseconds window, Clock::time_point now) const
+{
+	const int64_t window_end = ToNanoseconds(now);
+	const int64_t window_begin = window_end - window.count();
+
+	RequestStats stats;
+	std::lock_guard guard(state_->mutex);
+
+	//the first minute that starts inside the window
+	const int64_t first_interval = GetInterval(window_begin - 1) + 1;
+	for (auto it = state_->aggregates.lower_bound(first_interval);
+		it != state_->aggregates.end() && it->first * AGGREGATE_INTERVAL_NS <= window_end; ++it)
+	{
+		const Aggregate& aggregate = it->second;
+		stats.request_count += aggregate.request_count;
+		stats.no_result_count += aggregate.no_result_count;
+		stats.latency.Merge(aggregate.latency);
+	}
+
+	for (const auto& ring : state_->rings)
+	{
+		const uint64_t head = ring->head.load(std::memory_order_acquire);
+		//folding happens under the mutex we hold, so the unfolded records are still in the ring
+		const uint64_t first = std::max(head > ring_capacity_ ? head - ring_capacity_ : 0, ring->folded);
+
+		//walk newest to oldest, a thread records in time order
+		for (uint64_t index = head; index > first; --index)
+		{
+			const Slot& slot = ring->slots[(index - 1) % ring_capacity_];
+			const uint64_t expected_sequence = 2 * (index - 1) + 2;
+			if (slot.sequence.load(std::memory_order_acquire) != expected_sequence)
+			{
+				break;
+			}
+			const int64_t finish_time = slot.finish_time_ns.load(std::memory_order_relaxed);
+			const uint64_t latency = slot.latency_ns.load(std::memory_order_relaxed);
+			const uint64_t found_docs = slot.found_docs.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			//the writer lapped us while reading this slot, everything older is gone too
+			if (slot.sequence.load(std::memory_order_relaxed) != expected_sequence)
+			{
+				break;
+			}
+			if (finish_time < window_begin)
+			{
+				break;
+			}
+			if (finish_time > window_end)
+			{
+				continue;
+			}
+			AddRecord(stats, latency, found_docs);
+		}
+	}
+
+	if (stats.request_count != 0)
+	{
+		stats.no_result_rate = static_cast<double>(stats.no_result_count) / stats.request_count;
+	}
+	const std::chrono::nanoseconds uptime = std::max(std::chrono::nanoseconds(1), std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_time_));
+	const std::chrono::nanoseconds rate_window = std::min(window, uptime);
+	if (rate_window.count() > 0)
+	{
+		stats.queries_per_second = stats.request_count / std::chrono::duration<double>(rate_window).count();
+	}
+	return stats;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "instrumentation.h"
+
+struct RequestStats {
+	uint64_t request_count = 0;
+	uint64_t no_result_count = 0;
+	double no_result_rate = 0.0;
+	double queries_per_second = 0.0;
+	HistogramSnapshot latency;
+};
+
+//every recording thread owns a ring buffer, readers aggregate all rings without stopping the writers;
+//records about to be overwritten, and the rings of exited threads, are folded into per-minute aggregates
+class RequestTracker {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	//aggregates older than retention are dropped
+	explicit RequestTracker(size_t ring_capacity = DEFAULT_RING_CAPACITY, std::chrono::nanoseconds retention = std::chrono::hours(24));
+
+	RequestTracker(const RequestTracker&) = delete;
+	RequestTracker& operator=(const RequestTracker&) = delete;
+
+	void Record(Clock::time_point finish_time, std::chrono::nanoseconds latency, size_t found_docs);
+
+	//requests still in a ring are counted by finish time, aggregated ones if their minute starts in the window;
+	//the rate is taken over the window or the tracker uptime, whichever is shorter
+	RequestStats GetStats(std::chrono::nanoseconds window) const;
+	RequestStats GetStats(std::chrono::nanoseconds window, Clock::time_point now) const;
+
+	const static size_t DEFAULT_RING_CAPACITY = size_t{ 1 } << 16;
+
+private:
+	//sequence is odd while the owner rewrites the slot, readers drop slots whose sequence changed under them
+	struct Slot {
+		std::atomic<uint64_t> sequence{ 0 };
+		std::atomic<int64_t> finish_time_ns{ 0 };
+		std::atomic<uint64_t> latency_ns{ 0 };
+		std::atomic<uint64_t> found_docs{ 0 };
+	};
+
+	struct Ring {
+		explicit Ring(size_t capacity) : slots(capacity)
+		{
+		}
+
+		std::vector<Slot> slots;
+		std::atomic<uint64_t> head{ 0 };
+		//records before this index are in the aggregates; changed by the owner under the state mutex
+		uint64_t folded = 0;
+	};
+
+	struct Aggregate {
+		uint64_t request_count = 0;
+		uint64_t no_result_count = 0;
+		HistogramSnapshot latency;
+	};
+
+	//shared with the thread-local ring handles, which may outlive the tracker
+	struct State {
+		explicit State(std::chrono::nanoseconds retention) : retention(retention)
+		{
+		}
+
+		const std::chrono::nanoseconds retention;
+		std::mutex mutex;
+		std::vector<std::unique_ptr<Ring>> rings;
+		//keyed by minute of the finish time
+		std::map<int64_t, Aggregate> aggregates;
+	};
+
+	class ThreadRings;
+
+	const size_t ring_capacity_;
+	//records folded at once, so the state mutex is taken once per this many requests of a full ring
+	const size_t fold_batch_size_;
+	const uint64_t tracker_id_;
+	const Clock::time_point start_time_;
+	std::shared_ptr<State> state_;
+
+	Ring& GetThreadRing();
+
+	//moves records [ring.folded, end) into the aggregates; the caller holds state.mutex and owns the ring
+	static void Fold(State& state, Ring& ring, uint64_t end);
+};
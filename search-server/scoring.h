@@ -0,0 +1,44 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+//corpus-wide numbers a scorer may use, taken from the local index or from merged shard statistics
+struct ScoringContext {
+	int document_count = 0;
+	double average_document_length = 0.0;
+	//kept alongside the average so per-posting code multiplies instead of dividing
+	double inverse_average_document_length = 0.0;
+};
+
+//a scorer is a plain value type passed to FindTopDocuments, so its calls are inlined into the postings loop:
+//ComputeTermWeight runs once per query term, Score once per (term, document) posting
+
+//term count divided by document length, times log(N / df)
+struct TfIdfScorer {
+	double ComputeTermWeight(const ScoringContext& context, int document_freq) const
+	{
+		return std::log(context.document_count * 1.0 / document_freq);
+	}
+
+	double Score([[maybe_unused]] const ScoringContext& context, double term_weight, uint32_t term_count, uint32_t document_length) const
+	{
+		return term_count * (1.0 / document_length) * term_weight;
+	}
+};
+
+//Okapi BM25: saturating term count, normalised by document length relative to the corpus average
+struct Bm25Scorer {
+	double k1 = 1.2;
+	double b = 0.75;
+
+	double ComputeTermWeight(const ScoringContext& context, int document_freq) const
+	{
+		return std::log(1.0 + (context.document_count - document_freq + 0.5) / (document_freq + 0.5));
+	}
+
+	double Score(const ScoringContext& context, double term_weight, uint32_t term_count, uint32_t document_length) const
+	{
+		const double length_norm = k1 * (1.0 - b + b * document_length * context.inverse_average_document_length);
+		return term_weight * term_count * (k1 + 1.0) / (term_count + length_norm);
+	}
+};
@@ -13,11 +13,11 @@ SearchServer::SearchServer(const std::string& stop_words_text)
 {
 }
 
-std::set<int>::iterator SearchServer::begin()
+std::vector<int>::const_iterator SearchServer::begin() const
 {
 	return document_ids_.begin();
 }
-std::set<int>::iterator SearchServer::end()
+std::vector<int>::const_iterator SearchServer::end() const
 {
 	return document_ids_.end();
 }
@@ -27,37 +27,226 @@ void SearchServer::AddDocument(int document_id, const std::string_view document,
 {
 	using namespace std::literals;
 
-	if ((document_id < 0) || (documents_.count(document_id) > 0))
+	if ((document_id < 0) || (ordinals_.count(document_id) > 0))
 	{
 		throw std::invalid_argument("Invalid document_id"s);
 	}
 
 	storage_.push_back(std::string(document));
-	const std::vector<std::string_view> words = SearchServer::SplitIntoWordsNoStop(storage_.back());
+	const size_t document_storage_bytes = sizeof(std::string) + storage_.back().capacity();
+	try
+	{
+		IndexDocument(PrepareDocument(document_id, storage_.back(), status, ratings), document_storage_bytes);
+	}
+	catch (...)
+	{
+		storage_.pop_back();
+		throw;
+	}
+}
 
-	const double inv_word_count = 1.0 / words.size();
-	for (const std::string_view word : words)
+SearchServer::PreparedDocument SearchServer::PrepareDocument(int document_id, const std::string_view document, DocumentStatus status,
+	const std::vector<int>& ratings) const
+{
+	using namespace std::literals;
+
+	if (document_id < 0)
 	{
-		id_to_document_word_[document_id][word] += inv_word_count;
-		word_to_document_freqs_[word][document_id] += inv_word_count;
+		throw std::invalid_argument("Invalid document_id"s);
 	}
 
-	document_ids_.emplace(document_id);
-	documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status });
+	PreparedDocument prepared_document{ document_id, status, ComputeAverageRating(ratings), SplitIntoWordsNoStop(document), {}, document.size() };
+	if (near_duplicate_detector_)
+	{
+		prepared_document.sketch = near_duplicate_detector_->ComputeSketch(prepared_document.words);
+	}
+	return prepared_document;
 }
 
+void SearchServer::AddPreparedDocument(PreparedDocument document, std::shared_ptr<const void> text_owner)
+{
+	const size_t document_storage_bytes = document.text_bytes;
+	IndexDocument(std::move(document), document_storage_bytes);
+	if (external_storage_.empty() || external_storage_.back() != text_owner)
+	{
+		external_storage_.push_back(std::move(text_owner));
+	}
+}
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const
+void SearchServer::IndexDocument(PreparedDocument document, size_t document_storage_bytes)
 {
-	return SearchServer::FindTopDocuments(raw_query, [status]([[maybe_unused]] int document_id, [[maybe_unused]] DocumentStatus document_status, [[maybe_unused]] int rating)
-		{ return document_status == status; });
+	using namespace std::literals;
+
+	const int document_id = document.id;
+	const std::vector<std::string_view>& words = document.words;
+	if (ordinals_.count(document_id) > 0)
+	{
+		throw std::invalid_argument("Invalid document_id"s);
+	}
+	if (documents_.size() >= std::numeric_limits<uint32_t>::max())
+	{
+		throw std::length_error("Too many documents"s);
+	}
+
+	if (near_duplicate_detector_)
+	{
+		//the document was prepared before detection was enabled or by a server with other sketch options
+		if (document.sketch.size() != near_duplicate_detector_->GetSketchSize())
+		{
+			document.sketch = near_duplicate_detector_->ComputeSketch(words);
+		}
+		const NearDuplicateOptions& options = near_duplicate_detector_->GetOptions();
+		if (options.reject)
+		{
+			const auto similar = near_duplicate_detector_->FindSimilar(document.sketch, options.threshold);
+			if (!similar.empty())
+			{
+				throw std::invalid_argument("Document is a near duplicate of document "s + std::to_string(similar.front().first));
+			}
+		}
+	}
+
+	//(word, position) pairs: sorted, they give the terms in text order and each term's positions in ascending order
+	std::vector<std::pair<std::string_view, uint32_t>> word_positions(words.size());
+	for (uint32_t position = 0; position < words.size(); ++position)
+	{
+		word_positions[position] = { words[position], position };
+	}
+	std::sort(word_positions.begin(), word_positions.end());
+
+	const uint32_t ordinal = static_cast<uint32_t>(documents_.size());
+	std::vector<TermFrequency> document_words;
+	DocumentPositions document_positions;
+	std::vector<uint32_t> positions;
+	for (auto it = word_positions.begin(); it != word_positions.end();)
+	{
+		const std::string_view word = it->first;
+		const auto next = std::find_if(it, word_positions.end(), [word](const auto& word_position)
+			{ return word_position.first != word; });
+		const uint32_t term_count = static_cast<uint32_t>(next - it);
+
+		TermPostings& term = GetTermPostings(word);
+		document_words.push_back({ term.term_id, term_count });
+		term.postings.push_back({ ordinal, term_count });
+		UpdatePostingHistogram(term.postings.size() - 1, term.postings.size());
+
+		if (store_positions_)
+		{
+			positions.clear();
+			std::transform(it, next, std::back_inserter(positions), [](const auto& word_position)
+				{ return word_position.second; });
+			document_positions.AddTerm(positions);
+		}
+		it = next;
+	}
+	document_words.shrink_to_fit();
+	posting_count_ += document_words.size();
+	total_document_length_ += words.size();
+	if (store_positions_)
+	{
+		positions_bytes_ += document_positions.GetByteSize();
+		document_positions_.push_back(std::move(document_positions));
+	}
+
+	document_words_.push_back(std::move(document_words));
+	documents_.push_back(DocumentData{ document_id, document.rating, document.status, document_storage_bytes, static_cast<uint32_t>(words.size()) });
+	ordinals_.emplace(document_id, ordinal);
+	document_ids_.insert(std::lower_bound(document_ids_.begin(), document_ids_.end(), document_id), document_id);
+	storage_bytes_ += document_storage_bytes;
+
+	if (near_duplicate_detector_)
+	{
+		near_duplicate_detector_->Add(document_id, std::move(document.sketch));
+	}
 }
 
-template <typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentStatus status) const
+void SearchServer::EnableNearDuplicateDetection(const NearDuplicateOptions& options)
+{
+	near_duplicate_detector_ = std::make_unique<NearDuplicateDetector>(options);
+	for (const int document_id : document_ids_)
+	{
+		const std::vector<TermFrequency>& document_words = document_words_[ordinals_.at(document_id)];
+		std::vector<std::string_view> words(document_words.size());
+		std::transform(document_words.begin(), document_words.end(), words.begin(), [this](const TermFrequency& entry)
+			{ return terms_[entry.term_id]; });
+		near_duplicate_detector_->Add(document_id, near_duplicate_detector_->ComputeSketch(words));
+	}
+}
+
+void SearchServer::EnablePositionalIndex()
+{
+	using namespace std::literals;
+	if (GetDocumentCount() != 0)
+	{
+		throw std::logic_error("Positional index can be enabled only on an empty server"s);
+	}
+	//tombstones of removed documents get empty position lists
+	document_positions_.resize(documents_.size());
+	store_positions_ = true;
+}
+
+void SearchServer::EnableFuzzyMatching(const FuzzyMatchingOptions& options)
 {
-	return SearchServer::FindTopDocuments(policy, raw_query, [status]([[maybe_unused]] int document_id, [[maybe_unused]] DocumentStatus document_status, [[maybe_unused]] int rating)
-		{ return document_status == status; });
+	fuzzy_index_ = std::make_unique<FuzzyIndex>(options);
+	for (const auto& [word, term] : word_to_document_freqs_)
+	{
+		fuzzy_index_->AddTerm(term.term_id, word);
+	}
+}
+
+void SearchServer::EnableQueryLog()
+{
+	query_log_ = std::make_unique<QueryLog>();
+}
+
+std::vector<HotTerm> SearchServer::GetHotTerms(size_t max_count) const
+{
+	using namespace std::literals;
+	if (!query_log_)
+	{
+		throw std::logic_error("Query log is disabled"s);
+	}
+	return query_log_->GetHotTerms(max_count);
+}
+
+std::future<WarmupResult> SearchServer::WarmUp(std::vector<HotTerm> hot_terms) const
+{
+	return std::async(std::launch::async, [this, hot_terms = std::move(hot_terms)]
+		{
+			WarmupResult result;
+			for (const HotTerm& hot_term : hot_terms)
+			{
+				const auto postings = word_to_document_freqs_.find(hot_term.term);
+				if (postings == word_to_document_freqs_.end())
+				{
+					continue;
+				}
+				++result.term_count;
+				result.posting_count += postings->second.postings.size();
+				for (const auto& [ordinal, term_count] : postings->second.postings)
+				{
+					const DocumentData& document_data = documents_[ordinal];
+					result.checksum += term_count + document_data.length + static_cast<uint64_t>(document_data.rating);
+				}
+			}
+			return result;
+		});
+}
+
+std::vector<std::pair<int, double>> SearchServer::FindNearDuplicates(int document_id) const
+{
+	using namespace std::literals;
+	if (!near_duplicate_detector_)
+	{
+		throw std::logic_error("Near duplicate detection is disabled"s);
+	}
+	return near_duplicate_detector_->FindSimilar(document_id);
+}
+
+
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const
+{
+	return SearchServer::FindTopDocuments(raw_query, DocumentStatusIs{ status });
 }
 
 
@@ -66,37 +255,92 @@ std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_
 	return SearchServer::FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
-template<typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query) const
+int SearchServer::GetDocumentCount() const
 {
-	return SearchServer::FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+	return static_cast<int>(document_ids_.size());
 }
 
-int SearchServer::GetDocumentCount() const
+CorpusStatistics SearchServer::GetCorpusStatistics(const std::string_view raw_query) const
+{
+	CorpusStatistics corpus_statistics;
+	corpus_statistics.document_count = GetDocumentCount();
+	corpus_statistics.total_document_length = total_document_length_;
+
+	//the words are reported before correction: whether one is missing, and what it is corrected to, is decided over all shards
+	const Query query = ParseQuery(std::execution::seq, raw_query);
+	for (const std::string_view word : query.plus_words)
+	{
+		const auto posting = word_to_document_freqs_.find(word);
+		corpus_statistics.document_freqs.emplace(word, posting == word_to_document_freqs_.end() ? 0 : static_cast<int>(posting->second.postings.size()));
+		//every shard reports its terms near the word, so their merged counts are global
+		if (fuzzy_index_)
+		{
+			for (const auto& [term_id, distance] : fuzzy_index_->Lookup(word, terms_))
+			{
+				corpus_statistics.document_freqs.emplace(terms_[term_id], static_cast<int>(word_to_document_freqs_.at(terms_[term_id]).postings.size()));
+			}
+		}
+	}
+	//every expansion is reported, so the capped set is chosen from counts over all shards
+	for (const std::string_view prefix : query.plus_prefixes)
+	{
+		for (auto term = word_to_document_freqs_.lower_bound(prefix);
+			term != word_to_document_freqs_.end() && term->first.substr(0, prefix.size()) == prefix; ++term)
+		{
+			corpus_statistics.document_freqs.emplace(term->first, static_cast<int>(term->second.postings.size()));
+		}
+	}
+	return corpus_statistics;
+}
+
+bool SearchServer::IsMoreRelevant(const Document& lhs, const Document& rhs)
 {
-	return static_cast<int>(documents_.size());
+	if (std::abs(lhs.relevance - rhs.relevance) < EPSILON)
+	{
+		if (lhs.rating == rhs.rating)
+		{
+			return lhs.id < rhs.id;
+		}
+		return lhs.rating > rhs.rating;
+	}
+	else
+	{
+		return lhs.relevance > rhs.relevance;
+	}
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::string_view raw_query, int document_id) const
 {
 	using namespace std::literals;
-	if (document_ids_.count(document_id) == 0)
+	const auto ordinal_entry = ordinals_.find(document_id);
+	if (ordinal_entry == ordinals_.end())
 	{
 		throw std::out_of_range("Document's id doesn't exist"s);
 	}
+	const uint32_t ordinal = ordinal_entry->second;
+	INSTRUMENT_STAGE(Stage::MATCH);
 
-	const SearchServer::Query query = ParseQuery(std::execution::seq, raw_query);
+	SearchServer::Query query = ParseQuery(std::execution::seq, raw_query);
+	if (fuzzy_index_)
+	{
+		CorrectPlusWords(query, nullptr);
+	}
 
 	for (const std::string_view word : query.minus_words) {
 		if (word_to_document_freqs_.count(word) == 0)
 		{
 			continue;
 		}
-		if (word_to_document_freqs_.at(word).count(document_id) != 0) {
-			return { {}, documents_.at(document_id).status };
+		if (HasPosting(word_to_document_freqs_.at(word).postings, ordinal)) {
+			return { std::vector<std::string_view>{}, documents_[ordinal].status };
 		}
 	}
 
+	if (HasMinusPrefixMatch(ordinal, query) || !MatchesPhrases(ordinal, query.phrases))
+	{
+		return { std::vector<std::string_view>{}, documents_[ordinal].status };
+	}
+
 	std::vector<std::string_view> matched_words;
 
 	for (const std::string_view word : query.plus_words)
@@ -105,13 +349,21 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
 		{
 			continue;
 		}
-		if (word_to_document_freqs_.at(word).count(document_id) != 0)
+		if (HasPosting(word_to_document_freqs_.at(word).postings, ordinal))
 		{
 			matched_words.push_back(std::move(word));
 		}
 	}
 
-	return { matched_words, documents_.at(document_id).status };
+	if (!query.plus_prefixes.empty())
+	{
+		const std::vector<std::string_view> prefix_words = MatchPlusPrefixes(ordinal, query);
+		matched_words.insert(matched_words.end(), prefix_words.begin(), prefix_words.end());
+		std::sort(matched_words.begin(), matched_words.end());
+		matched_words.erase(std::unique(matched_words.begin(), matched_words.end()), matched_words.end());
+	}
+
+	return { matched_words, documents_[ordinal].status };
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::sequenced_policy&, const std::string_view raw_query, int document_id) const
@@ -122,64 +374,119 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::parallel_policy& policy, const std::string_view raw_query, int document_id) const
 {
 	using namespace std::literals;
-	if (document_ids_.count(document_id) == 0)
+	const auto ordinal_entry = ordinals_.find(document_id);
+	if (ordinal_entry == ordinals_.end())
 	{
 		throw std::out_of_range("Document's id doesn't exist"s);
 	}
+	const uint32_t ordinal = ordinal_entry->second;
+	INSTRUMENT_STAGE(Stage::MATCH);
 
-	const auto& doc_id = id_to_document_word_.at(document_id);
+	const auto& doc_id = document_words_[ordinal];
 	SearchServer::Query query = ParseQuery(std::execution::par, raw_query);
+	if (fuzzy_index_)
+	{
+		CorrectPlusWords(query, nullptr);
+	}
 
 	if (std::any_of(query.minus_words.begin(), query.minus_words.end(), [&](const std::string_view word)
 		{
-			return doc_id.count(word) != 0;
+			return HasWord(doc_id, word);
 		}))
 	{
-		return { {}, documents_.at(document_id).status };
+		return { std::vector<std::string_view>{}, documents_[ordinal].status };
 	}
 
-	std::vector<std::string_view> matched_words;
+	if (HasMinusPrefixMatch(ordinal, query) || !MatchesPhrases(ordinal, query.phrases))
+	{
+		return { std::vector<std::string_view>{}, documents_[ordinal].status };
+	}
 
-	matched_words.resize(query.plus_words.size());
+	std::vector<std::string_view> matched_words = MatchPlusPrefixes(ordinal, query);
+	const size_t prefix_word_count = matched_words.size();
 
-	auto last_elem = std::copy_if(query.plus_words.begin(), query.plus_words.end(), matched_words.begin(), [&](const std::string_view word)
+	matched_words.resize(prefix_word_count + query.plus_words.size());
+
+	auto last_elem = std::copy_if(query.plus_words.begin(), query.plus_words.end(), matched_words.begin() + prefix_word_count, [&](const std::string_view word)
 		{
-			return doc_id.count(word) != 0;
+			return HasWord(doc_id, word);
 		});
 
 	std::sort(matched_words.begin(), last_elem);
 
 	matched_words.erase(std::unique(matched_words.begin(), last_elem), matched_words.end());
 
-	return { matched_words, documents_.at(document_id).status };
+	return { matched_words, documents_[ordinal].status };
 }
 
-const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const
+WordFrequencies SearchServer::GetWordFrequencies(int document_id) const
 {
-	const auto itera = id_to_document_word_.find(document_id);
-	if (itera != id_to_document_word_.end())
+	const auto ordinal_entry = ordinals_.find(document_id);
+	if (ordinal_entry != ordinals_.end())
 	{
-		return itera->second;
+		const uint32_t ordinal = ordinal_entry->second;
+		return { document_words_[ordinal], terms_, documents_[ordinal].length };
 	}
 
-	static std::map<std::string_view, double> empty_map = {};
-	return empty_map;
+	return {};
+}
+
+IndexStats SearchServer::GetStats() const
+{
+	//the container figures are estimates: node layouts below are those of libstdc++ and libc++
+	//std::map node: color + parent/left/right pointers before the value
+	const size_t node_overhead = sizeof(int) + 3 * sizeof(void*);
+	//std::unordered_map node: next pointer before the value, plus one bucket pointer
+	const size_t hash_node_overhead = sizeof(void*);
+	const size_t term_count = word_to_document_freqs_.size();
+	const size_t document_count = document_ids_.size();
+
+	IndexStats stats;
+	stats.document_count = document_count;
+	stats.term_count = term_count;
+	stats.dictionary_term_count = terms_.size() - free_term_ids_.size();
+	stats.posting_count = posting_count_;
+
+	stats.storage_bytes = storage_bytes_;
+	stats.dead_storage_bytes = dead_storage_bytes_;
+	stats.inverted_index_bytes = term_count * (node_overhead + sizeof(std::pair<const std::string_view, TermPostings>))
+		+ posting_count_ * sizeof(Posting);
+	stats.forward_index_bytes = document_words_.capacity() * sizeof(std::vector<TermFrequency>)
+		+ posting_count_ * sizeof(TermFrequency);
+	stats.fuzzy_index_bytes = fuzzy_index_ ? fuzzy_index_->GetByteSize() : 0;
+	stats.positions_bytes = positions_bytes_ + document_positions_.capacity() * sizeof(DocumentPositions);
+	stats.dictionary_bytes = terms_.capacity() * sizeof(std::string_view) + free_term_ids_.capacity() * sizeof(uint32_t);
+	stats.documents_bytes = documents_.capacity() * sizeof(DocumentData)
+		+ document_ids_.capacity() * sizeof(int)
+		+ ordinals_.bucket_count() * sizeof(void*) + ordinals_.size() * (hash_node_overhead + sizeof(std::pair<const int, uint32_t>));
+
+	//document texts; a map node and a posting buffer per term; a forward index buffer per document;
+	//the dictionary buffers; hash nodes and buckets; the per-document vectors and the id vector; two buffers per position list
+	stats.estimated_allocation_count = storage_.size() + 2 * term_count + document_count
+		+ 2 + ordinals_.size() + 1 + 4 + 2 * document_positions_.size();
+	stats.posting_length_histogram = posting_length_histogram_;
+	return stats;
 }
 
 void SearchServer::RemoveDocument(int document_id)
 {
-	for (auto& [word, _] : id_to_document_word_.at(document_id))
+	const uint32_t ordinal = ordinals_.at(document_id);
+	for (const TermFrequency& entry : document_words_[ordinal])
 	{
-		word_to_document_freqs_.at(word).erase(document_id);
-		if (word_to_document_freqs_.at(word).empty())
+		const std::string_view word = terms_[entry.term_id];
+		std::vector<Posting>& posting = word_to_document_freqs_.at(word).postings;
+		posting.erase(std::lower_bound(posting.begin(), posting.end(), ordinal, [](const Posting& lhs, uint32_t rhs)
+			{ return lhs.ordinal < rhs; }));
+		UpdatePostingHistogram(posting.size() + 1, posting.size());
+		if (posting.empty())
 		{
-			word_to_document_freqs_.erase(word);
+			ReleaseTerm(word);
 		}
 	}
 
-	id_to_document_word_.erase(document_id);
-	documents_.erase(document_id);
-	document_ids_.erase(document_id);
+	document_ids_.erase(std::lower_bound(document_ids_.begin(), document_ids_.end(), document_id));
+	ReleaseDocument(ordinal);
+	CompactDocumentsIfNeeded();
 }
 
 void SearchServer::RemoveDocument(const std::execution::sequenced_policy&, int document_id)
@@ -189,26 +496,111 @@ void SearchServer::RemoveDocument(const std::execution::sequenced_policy&, int d
 
 void SearchServer::RemoveDocument(const std::execution::parallel_policy& policy, int document_id)
 {
-	if (document_ids_.count(document_id) > 0)
+	SearchServer::RemoveDocuments(policy, { document_id });
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::CommonOfRemoveDocuments(const ExecutionPolicy& policy, const std::vector<int>& document_ids)
+{
+	std::vector<uint32_t> removed_ordinals;
+	removed_ordinals.reserve(document_ids.size());
+	for (const int document_id : document_ids)
 	{
-		const std::map<std::string_view, double>& document = id_to_document_word_.at(document_id);
-		std::vector<std::string_view> vec(document.size());
+		const auto ordinal_entry = ordinals_.find(document_id);
+		if (ordinal_entry != ordinals_.end())
+		{
+			removed_ordinals.push_back(ordinal_entry->second);
+		}
+	}
+	std::sort(removed_ordinals.begin(), removed_ordinals.end());
+	removed_ordinals.erase(std::unique(removed_ordinals.begin(), removed_ordinals.end()), removed_ordinals.end());
+
+	//grouped by term, so every affected posting list is rewritten by exactly one task
+	std::vector<std::pair<uint32_t, uint32_t>> removed_postings;
+	for (const uint32_t ordinal : removed_ordinals)
+	{
+		for (const TermFrequency& entry : document_words_[ordinal])
+		{
+			removed_postings.emplace_back(entry.term_id, ordinal);
+		}
+	}
+	std::sort(policy, removed_postings.begin(), removed_postings.end());
 
-		std::transform(policy, document.begin(), document.end(), vec.begin(), [](const auto& pair)
-			{ return pair.first; });
+	struct PostingRewrite {
+		uint32_t term_id;
+		std::vector<Posting>* posting;
+		size_t first;
+		size_t last;
+	};
 
-		std::for_each(policy, vec.begin(), vec.end(), [&](const std::string_view doc)
+	std::vector<PostingRewrite> rewrites;
+	for (size_t first = 0; first < removed_postings.size();)
+	{
+		const uint32_t term_id = removed_postings[first].first;
+		size_t last = first;
+		while (last < removed_postings.size() && removed_postings[last].first == term_id)
+		{
+			++last;
+		}
+		rewrites.push_back({ term_id, &word_to_document_freqs_.at(terms_[term_id]).postings, first, last });
+		first = last;
+	}
+
+	//both the posting list and its removed ordinals are sorted, so one compacting pass drops them all
+	std::for_each(policy, rewrites.begin(), rewrites.end(), [&removed_postings](const PostingRewrite& rewrite)
+		{
+			std::vector<Posting>& posting = *rewrite.posting;
+			size_t removed = rewrite.first;
+			size_t kept = 0;
+			for (const Posting& entry : posting)
 			{
-				if (word_to_document_freqs_.count(doc) != 0)
+				if (removed < rewrite.last && removed_postings[removed].second == entry.ordinal)
 				{
-					word_to_document_freqs_.at(doc).erase(document_id);
+					++removed;
+					continue;
 				}
-			});
+				posting[kept++] = entry;
+			}
+			posting.resize(kept);
+		});
 
-		id_to_document_word_.erase(document_id);
-		documents_.erase(document_id);
-		document_ids_.erase(document_id);
+	for (const PostingRewrite& rewrite : rewrites)
+	{
+		const size_t posting_length = rewrite.posting->size();
+		UpdatePostingHistogram(posting_length + rewrite.last - rewrite.first, posting_length);
+		if (posting_length == 0)
+		{
+			ReleaseTerm(terms_[rewrite.term_id]);
+		}
+	}
+
+	//one pass over the sorted ids instead of a shifting erase per removed document
+	std::vector<int> removed_ids;
+	removed_ids.reserve(removed_ordinals.size());
+	for (const uint32_t ordinal : removed_ordinals)
+	{
+		removed_ids.push_back(documents_[ordinal].id);
+		ReleaseDocument(ordinal);
 	}
+	std::sort(removed_ids.begin(), removed_ids.end());
+	document_ids_.erase(std::remove_if(document_ids_.begin(), document_ids_.end(), [&removed_ids](int document_id)
+		{ return std::binary_search(removed_ids.begin(), removed_ids.end(), document_id); }), document_ids_.end());
+	CompactDocumentsIfNeeded();
+}
+
+void SearchServer::RemoveDocuments(const std::vector<int>& document_ids)
+{
+	CommonOfRemoveDocuments(std::execution::seq, document_ids);
+}
+
+void SearchServer::RemoveDocuments(const std::execution::sequenced_policy& policy, const std::vector<int>& document_ids)
+{
+	CommonOfRemoveDocuments(policy, document_ids);
+}
+
+void SearchServer::RemoveDocuments(const std::execution::parallel_policy& policy, const std::vector<int>& document_ids)
+{
+	CommonOfRemoveDocuments(policy, document_ids);
 }
 
 bool SearchServer::IsStopWord(const std::string_view word) const
@@ -216,6 +608,374 @@ bool SearchServer::IsStopWord(const std::string_view word) const
 	return stop_words_.count(word) > 0;
 }
 
+void SearchServer::UpdatePostingHistogram(size_t old_length, size_t new_length)
+{
+	if (old_length != 0)
+	{
+		--posting_length_histogram_[GetPostingHistogramBucket(old_length)];
+	}
+	if (new_length != 0)
+	{
+		++posting_length_histogram_[GetPostingHistogramBucket(new_length)];
+	}
+}
+
+SearchServer::TermPostings& SearchServer::GetTermPostings(const std::string_view word)
+{
+	const auto term = word_to_document_freqs_.lower_bound(word);
+	if (term != word_to_document_freqs_.end() && term->first == word)
+	{
+		return term->second;
+	}
+
+	uint32_t term_id = static_cast<uint32_t>(terms_.size());
+	if (free_term_ids_.empty())
+	{
+		terms_.push_back(word);
+	}
+	else
+	{
+		term_id = free_term_ids_.back();
+		free_term_ids_.pop_back();
+		terms_[term_id] = word;
+	}
+	if (fuzzy_index_)
+	{
+		fuzzy_index_->AddTerm(term_id, word);
+	}
+	return word_to_document_freqs_.emplace_hint(term, word, TermPostings{ term_id, {} })->second;
+}
+
+void SearchServer::ReleaseTerm(const std::string_view word)
+{
+	const auto term = word_to_document_freqs_.find(word);
+	const uint32_t term_id = term->second.term_id;
+	if (fuzzy_index_)
+	{
+		fuzzy_index_->RemoveTerm(term_id, word);
+	}
+	terms_[term_id] = {};
+	free_term_ids_.push_back(term_id);
+	word_to_document_freqs_.erase(term);
+}
+
+std::vector<TermFrequency>::const_iterator SearchServer::FindWord(const std::vector<TermFrequency>& document_words, const std::string_view word) const
+{
+	const auto entry = std::lower_bound(document_words.begin(), document_words.end(), word,
+		[this](const TermFrequency& lhs, const std::string_view rhs) { return terms_[lhs.term_id] < rhs; });
+	return (entry != document_words.end() && terms_[entry->term_id] == word) ? entry : document_words.end();
+}
+
+bool SearchServer::HasWord(const std::vector<TermFrequency>& document_words, const std::string_view word) const
+{
+	return FindWord(document_words, word) != document_words.end();
+}
+
+bool SearchServer::HasPosting(const std::vector<Posting>& posting, uint32_t ordinal)
+{
+	const auto entry = std::lower_bound(posting.begin(), posting.end(), ordinal, [](const Posting& lhs, uint32_t rhs)
+		{ return lhs.ordinal < rhs; });
+	return entry != posting.end() && entry->ordinal == ordinal;
+}
+
+bool SearchServer::MatchesPhrases(uint32_t ordinal, const std::vector<std::vector<std::string_view>>& phrases) const
+{
+	if (phrases.empty())
+	{
+		return true;
+	}
+
+	const std::vector<TermFrequency>& document_words = document_words_[ordinal];
+	const DocumentPositions& document_positions = document_positions_[ordinal];
+	for (const std::vector<std::string_view>& phrase : phrases)
+	{
+		//cheap presence check of every word before any positions are decoded
+		std::vector<size_t> entries;
+		for (const std::string_view word : phrase)
+		{
+			const auto entry = FindWord(document_words, word);
+			if (entry == document_words.end())
+			{
+				return false;
+			}
+			entries.push_back(entry - document_words.begin());
+		}
+
+		std::vector<std::vector<uint32_t>> phrase_positions;
+		for (const size_t entry : entries)
+		{
+			phrase_positions.push_back(document_positions.GetPositions(entry));
+		}
+		if (!DocumentPositions::ContainsPhrase(phrase_positions))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+SearchServer::PrefixExpansion SearchServer::ExpandPrefix(const std::string_view prefix, const CorpusStatistics* corpus_statistics) const
+{
+	//(document freq, term) of every expansion; both dictionaries are sorted, so the expansions are one contiguous range.
+	//With merged shard statistics every shard ranks the same counts and chooses the same terms
+	std::vector<std::pair<int, std::string_view>> candidates;
+	if (corpus_statistics != nullptr)
+	{
+		const auto& document_freqs = corpus_statistics->document_freqs;
+		for (auto term = document_freqs.lower_bound(prefix);
+			term != document_freqs.end() && std::string_view(term->first).substr(0, prefix.size()) == prefix; ++term)
+		{
+			if (term->second > 0)
+			{
+				candidates.emplace_back(term->second, term->first);
+			}
+		}
+	}
+	else
+	{
+		for (auto term = word_to_document_freqs_.lower_bound(prefix);
+			term != word_to_document_freqs_.end() && term->first.substr(0, prefix.size()) == prefix; ++term)
+		{
+			candidates.emplace_back(static_cast<int>(term->second.postings.size()), term->first);
+		}
+	}
+
+	if (candidates.size() > MAX_PREFIX_EXPANSION_COUNT)
+	{
+		//ties in term order, so the choice does not depend on the shard
+		std::nth_element(candidates.begin(), candidates.begin() + MAX_PREFIX_EXPANSION_COUNT, candidates.end(), [](const auto& lhs, const auto& rhs)
+			{ return lhs.first > rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second); });
+		candidates.resize(MAX_PREFIX_EXPANSION_COUNT);
+	}
+
+	PrefixExpansion expansion;
+	int64_t document_freq = 0;
+	for (const auto& [term_document_freq, word] : candidates)
+	{
+		document_freq += term_document_freq;
+		const auto term = word_to_document_freqs_.find(word);
+		if (term != word_to_document_freqs_.end())
+		{
+			expansion.terms.push_back(term);
+		}
+	}
+	//the exact union would need the postings of every shard; the sum is exact when expansions do not share documents
+	const int document_count = corpus_statistics != nullptr ? corpus_statistics->document_count : GetDocumentCount();
+	expansion.document_freq = static_cast<int>(std::min<int64_t>(document_freq, document_count));
+	return expansion;
+}
+
+std::vector<SearchServer::Posting> SearchServer::MergePrefixPostings(const std::vector<PostingIterator>& terms)
+{
+	using Cursor = std::pair<std::vector<Posting>::const_iterator, std::vector<Posting>::const_iterator>;
+	std::vector<Cursor> cursors;
+	for (const PostingIterator term : terms)
+	{
+		cursors.emplace_back(term->second.postings.begin(), term->second.postings.end());
+	}
+
+	//k-way merge of the expanded posting lists in ordinal order; posting lists are never empty
+	const auto has_greater_ordinal = [](const Cursor& lhs, const Cursor& rhs)
+		{ return lhs.first->ordinal > rhs.first->ordinal; };
+	std::make_heap(cursors.begin(), cursors.end(), has_greater_ordinal);
+
+	std::vector<Posting> postings;
+	while (!cursors.empty())
+	{
+		std::pop_heap(cursors.begin(), cursors.end(), has_greater_ordinal);
+		Cursor& cursor = cursors.back();
+		const auto [ordinal, term_count] = *cursor.first;
+		if (!postings.empty() && postings.back().ordinal == ordinal)
+		{
+			postings.back().count += term_count;
+		}
+		else
+		{
+			postings.push_back({ ordinal, term_count });
+		}
+
+		if (++cursor.first == cursor.second)
+		{
+			cursors.pop_back();
+		}
+		else
+		{
+			std::push_heap(cursors.begin(), cursors.end(), has_greater_ordinal);
+		}
+	}
+	return postings;
+}
+
+bool SearchServer::HasMinusPrefixMatch(uint32_t ordinal, const Query& query) const
+{
+	//exclusion has to be exact, so minus prefixes are not capped; the forward index is sorted by text,
+	//so the first entry not below the prefix is an expansion if the document has any
+	const std::vector<TermFrequency>& document_words = document_words_[ordinal];
+	for (const std::string_view prefix : query.minus_prefixes)
+	{
+		const auto entry = std::lower_bound(document_words.begin(), document_words.end(), prefix,
+			[this](const TermFrequency& lhs, const std::string_view rhs) { return terms_[lhs.term_id] < rhs; });
+		if (entry != document_words.end() && terms_[entry->term_id].substr(0, prefix.size()) == prefix)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+std::vector<const std::vector<SearchServer::Posting>*> SearchServer::GetScannedPostings(const std::vector<std::string_view>& words, const std::vector<std::vector<Posting>>& prefix_postings) const
+{
+	std::vector<const std::vector<Posting>*> scanned_postings;
+	scanned_postings.reserve(words.size() + prefix_postings.size());
+	for (const std::string_view word : words)
+	{
+		const auto term = word_to_document_freqs_.find(word);
+		scanned_postings.push_back(term != word_to_document_freqs_.end() ? &term->second.postings : nullptr);
+	}
+	for (const std::vector<Posting>& postings : prefix_postings)
+	{
+		scanned_postings.push_back(&postings);
+	}
+	return scanned_postings;
+}
+
+bool SearchServer::HasPostingAtCursors(uint32_t ordinal, const std::vector<const std::vector<Posting>*>& postings, std::vector<size_t>& cursors)
+{
+	for (size_t i = 0; i < cursors.size(); ++i)
+	{
+		if (postings[i] == nullptr)
+		{
+			continue;
+		}
+		const std::vector<Posting>& posting = *postings[i];
+		size_t& cursor = cursors[i];
+		while (cursor < posting.size() && posting[cursor].ordinal < ordinal)
+		{
+			++cursor;
+		}
+		if (cursor < posting.size() && posting[cursor].ordinal == ordinal)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+std::vector<std::string_view> SearchServer::MatchPlusPrefixes(uint32_t ordinal, const Query& query) const
+{
+	std::vector<std::string_view> matched_words;
+	for (const std::string_view prefix : query.plus_prefixes)
+	{
+		for (const PostingIterator term : ExpandPrefix(prefix, nullptr).terms)
+		{
+			if (HasPosting(term->second.postings, ordinal))
+			{
+				matched_words.push_back(term->first);
+			}
+		}
+	}
+	return matched_words;
+}
+
+void SearchServer::ReleaseDocument(uint32_t ordinal)
+{
+	//the slot of a removed document stays as a tombstone, only its owned memory is freed
+	DocumentData& document_data = documents_[ordinal];
+	posting_count_ -= document_words_[ordinal].size();
+	total_document_length_ -= document_data.length;
+	dead_storage_bytes_ += document_data.storage_bytes;
+	std::vector<TermFrequency>().swap(document_words_[ordinal]);
+	if (store_positions_)
+	{
+		positions_bytes_ -= document_positions_[ordinal].GetByteSize();
+		document_positions_[ordinal] = DocumentPositions();
+	}
+	if (near_duplicate_detector_)
+	{
+		near_duplicate_detector_->Remove(document_data.id);
+	}
+	ordinals_.erase(document_data.id);
+}
+
+bool SearchServer::IsLiveOrdinal(uint32_t ordinal) const
+{
+	//an id that was removed and added again has a new ordinal, its old slot stays a tombstone
+	const auto ordinal_entry = ordinals_.find(documents_[ordinal].id);
+	return ordinal_entry != ordinals_.end() && ordinal_entry->second == ordinal;
+}
+
+void SearchServer::CompactDocumentsIfNeeded()
+{
+	const size_t removed_count = documents_.size() - ordinals_.size();
+	if (removed_count > MAX_REMOVED_DOCUMENT_FRACTION * documents_.size())
+	{
+		CompactDocuments();
+	}
+}
+
+void SearchServer::CompactDocuments()
+{
+	//live documents keep their relative order, so renumbered posting lists stay sorted
+	std::vector<uint32_t> new_ordinals(documents_.size());
+	uint32_t live_count = 0;
+	for (uint32_t ordinal = 0; ordinal < documents_.size(); ++ordinal)
+	{
+		if (!IsLiveOrdinal(ordinal))
+		{
+			continue;
+		}
+		new_ordinals[ordinal] = live_count;
+		if (live_count != ordinal)
+		{
+			documents_[live_count] = documents_[ordinal];
+			document_words_[live_count] = std::move(document_words_[ordinal]);
+			if (store_positions_)
+			{
+				document_positions_[live_count] = std::move(document_positions_[ordinal]);
+			}
+			ordinals_[documents_[live_count].id] = live_count;
+		}
+		++live_count;
+	}
+	documents_.resize(live_count);
+	documents_.shrink_to_fit();
+	document_words_.resize(live_count);
+	document_words_.shrink_to_fit();
+	if (store_positions_)
+	{
+		document_positions_.resize(live_count);
+		document_positions_.shrink_to_fit();
+	}
+
+	for (auto& [word, term] : word_to_document_freqs_)
+	{
+		for (Posting& posting : term.postings)
+		{
+			posting.ordinal = new_ordinals[posting.ordinal];
+		}
+	}
+
+	//a term may point into the text of a removed document, so every term gets its own copy and all document texts are released
+	std::deque<std::string> term_storage;
+	size_t term_storage_bytes = 0;
+	for (auto it = word_to_document_freqs_.begin(); it != word_to_document_freqs_.end();)
+	{
+		const std::string& term_text = term_storage.emplace_back(it->first);
+		term_storage_bytes += sizeof(std::string) + term_text.capacity();
+		terms_[it->second.term_id] = term_text;
+		auto node = word_to_document_freqs_.extract(it++);
+		node.key() = term_text;
+		word_to_document_freqs_.insert(it, std::move(node));
+	}
+	storage_ = std::move(term_storage);
+	external_storage_.clear();
+	storage_bytes_ = term_storage_bytes;
+	dead_storage_bytes_ = 0;
+	for (DocumentData& document_data : documents_)
+	{
+		document_data.storage_bytes = 0;
+	}
+}
 bool SearchServer::IsValidWord(const std::string_view word)
 {
 	return std::none_of(word.begin(), word.end(), [](char c)
@@ -268,12 +1028,20 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view& word) con
 			word = word.substr(1);
 		}
 
+		bool is_prefix = false;
+
+		if (!word.empty() && word.back() == '*')
+		{
+			is_prefix = true;
+			word.remove_suffix(1);
+		}
+
 		if (word.empty() || word[0] == '-' || !IsValidWord(word))
 		{
 			throw std::invalid_argument("Query word is invalid");
 		}
 
-		return { word, is_minus, IsStopWord(word) };
+		return { word, is_minus, !is_prefix && IsStopWord(word), is_prefix };
 	}
 }
 
@@ -285,15 +1053,74 @@ SearchServer::Query SearchServer::CommonOfParseQuery(const std::string_view text
 	result.plus_words.reserve(words.size());
 	result.minus_words.reserve(words.size());
 
+	std::vector<std::string_view>* phrase = nullptr;
 	for (std::string_view word : words)
 	{
-		const auto query_word = ParseQueryWord(word);
-		if (!query_word.is_stop) {
-			(query_word.is_minus) ?
-				result.minus_words.push_back(std::move(query_word.data))
-				: result.plus_words.push_back(std::move(query_word.data));
+		if (phrase == nullptr && word[0] == '"')
+		{
+			word.remove_prefix(1);
+			phrase = &result.phrases.emplace_back();
+		}
+
+		bool closes_phrase = false;
+		if (phrase != nullptr && !word.empty() && word.back() == '"')
+		{
+			word.remove_suffix(1);
+			closes_phrase = true;
 		}
+
+		if (!word.empty())
+		{
+			const auto query_word = ParseQueryWord(word);
+			if (phrase != nullptr && query_word.is_minus)
+			{
+				throw std::invalid_argument("Minus words are not allowed inside a phrase");
+			}
+			if (phrase != nullptr && query_word.is_prefix)
+			{
+				throw std::invalid_argument("Prefix terms are not allowed inside a phrase");
+			}
+			if (query_word.is_prefix)
+			{
+				(query_word.is_minus) ?
+					result.minus_prefixes.push_back(query_word.data)
+					: result.plus_prefixes.push_back(query_word.data);
+			}
+			else if (!query_word.is_stop) {
+				(query_word.is_minus) ?
+					result.minus_words.push_back(std::move(query_word.data))
+					: result.plus_words.push_back(std::move(query_word.data));
+				if (phrase != nullptr)
+				{
+					phrase->push_back(query_word.data);
+				}
+			}
+		}
+
+		if (closes_phrase)
+		{
+			phrase = nullptr;
+		}
+	}
+
+	if (phrase != nullptr)
+	{
+		throw std::invalid_argument("Phrase is not closed");
+	}
+	result.phrases.erase(std::remove_if(result.phrases.begin(), result.phrases.end(), [](const auto& words_of_phrase)
+		{ return words_of_phrase.empty(); }), result.phrases.end());
+	if (!result.phrases.empty() && !store_positions_)
+	{
+		throw std::invalid_argument("Phrase queries need the positional index");
 	}
+
+	//prefixes are rare and each one costs a posting merge, so they are deduplicated for both policies
+	for (std::vector<std::string_view>* prefixes : { &result.plus_prefixes, &result.minus_prefixes })
+	{
+		std::sort(prefixes->begin(), prefixes->end());
+		prefixes->erase(std::unique(prefixes->begin(), prefixes->end()), prefixes->end());
+	}
+
 	return result;
 }
 
@@ -317,7 +1144,158 @@ SearchServer::Query SearchServer::ParseQuery(const std::execution::parallel_poli
 	return CommonOfParseQuery(text);
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view word) const
+bool SearchServer::IsTermQuery(const Query& query)
+{
+	return !query.plus_words.empty() && query.plus_prefixes.empty() && query.minus_prefixes.empty() && query.phrases.empty();
+}
+
+void SearchServer::PushTopDocument(std::vector<Document>& top_documents, Document document)
+{
+	if (top_documents.size() < static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT))
+	{
+		top_documents.push_back(std::move(document));
+		std::push_heap(top_documents.begin(), top_documents.end(), IsMoreRelevant);
+	}
+	else if (IsMoreRelevant(document, top_documents.front()))
+	{
+		std::pop_heap(top_documents.begin(), top_documents.end(), IsMoreRelevant);
+		top_documents.back() = std::move(document);
+		std::push_heap(top_documents.begin(), top_documents.end(), IsMoreRelevant);
+	}
+}
+
+void SearchServer::RecordQuery(const Query& query) const
+{
+	std::vector<std::string_view> indexed_words;
+	for (const std::string_view word : query.plus_words)
+	{
+		if (word_to_document_freqs_.count(word) != 0)
+		{
+			indexed_words.push_back(word);
+		}
+	}
+	query_log_->Record(indexed_words);
+}
+
+void SearchServer::CorrectPlusWords(Query& query, const CorpusStatistics* corpus_statistics) const
 {
-	return log(SearchServer::GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+	const FuzzyMatchingOptions& options = fuzzy_index_->GetOptions();
+	std::vector<std::string_view> plus_words;
+	plus_words.reserve(query.plus_words.size());
+	//(misspelled word, its best correction); a phrase needs one word per position, so it only takes the best one
+	std::vector<std::pair<std::string_view, std::string_view>> best_corrections;
+	bool is_corrected = false;
+	for (const std::string_view word : query.plus_words)
+	{
+		if (corpus_statistics != nullptr ? GetDocumentFreq(word, corpus_statistics) != 0 : word_to_document_freqs_.count(word) != 0)
+		{
+			plus_words.push_back(word);
+			continue;
+		}
+
+		//(document freq, term) of the terms at the smallest distance; with shard statistics the candidates are
+		//the terms every shard reported near the word, so all shards make the same choice
+		std::vector<std::pair<int, std::string_view>> corrections;
+		int best_distance = options.max_edit_distance + 1;
+		if (corpus_statistics != nullptr)
+		{
+			for (const auto& [term, document_freq] : corpus_statistics->document_freqs)
+			{
+				const int distance = document_freq == 0 ? best_distance + 1 : FuzzyIndex::ComputeEditDistance(word, term, options.max_edit_distance);
+				if (distance < best_distance)
+				{
+					best_distance = distance;
+					corrections.clear();
+				}
+				if (distance == best_distance)
+				{
+					corrections.emplace_back(document_freq, term);
+				}
+			}
+		}
+		else
+		{
+			for (const auto& [term_id, distance] : fuzzy_index_->Lookup(word, terms_))
+			{
+				if (distance > best_distance)
+				{
+					break;
+				}
+				best_distance = distance;
+				corrections.emplace_back(static_cast<int>(word_to_document_freqs_.at(terms_[term_id]).postings.size()), terms_[term_id]);
+			}
+		}
+
+		std::sort(corrections.begin(), corrections.end(), [](const auto& lhs, const auto& rhs)
+			{ return lhs.first > rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second); });
+		corrections.resize(std::min(corrections.size(), options.max_expansion_count));
+		if (!corrections.empty())
+		{
+			best_corrections.emplace_back(word, corrections.front().second);
+		}
+		for (const auto& [document_freq, term] : corrections)
+		{
+			//a shard may lack the term, its postings are then simply empty
+			plus_words.push_back(term);
+		}
+		is_corrected = true;
+	}
+
+	//two misspellings may be corrected to the same term
+	if (is_corrected)
+	{
+		std::sort(plus_words.begin(), plus_words.end());
+		plus_words.erase(std::unique(plus_words.begin(), plus_words.end()), plus_words.end());
+	}
+	query.plus_words = std::move(plus_words);
+
+	//a phrase word without any correction stays misspelled, so the phrase matches nothing
+	for (std::vector<std::string_view>& phrase : query.phrases)
+	{
+		for (std::string_view& word : phrase)
+		{
+			const auto correction = std::find_if(best_corrections.begin(), best_corrections.end(), [word](const auto& entry)
+				{ return entry.first == word; });
+			if (correction != best_corrections.end())
+			{
+				word = correction->second;
+			}
+		}
+	}
+}
+
+ScoringContext SearchServer::GetScoringContext(const CorpusStatistics* corpus_statistics) const
+{
+	ScoringContext scoring_context;
+	uint64_t total_document_length = total_document_length_;
+	scoring_context.document_count = SearchServer::GetDocumentCount();
+	if (corpus_statistics != nullptr)
+	{
+		scoring_context.document_count = corpus_statistics->document_count;
+		total_document_length = corpus_statistics->total_document_length;
+	}
+	if (scoring_context.document_count != 0)
+	{
+		scoring_context.average_document_length = total_document_length * 1.0 / scoring_context.document_count;
+	}
+	if (total_document_length != 0)
+	{
+		scoring_context.inverse_average_document_length = 1.0 / scoring_context.average_document_length;
+	}
+	return scoring_context;
+}
+
+int SearchServer::GetDocumentFreq(const std::string_view word, const CorpusStatistics* corpus_statistics) const
+{
+	using namespace std::literals;
+	if (corpus_statistics != nullptr)
+	{
+		const auto document_freq = corpus_statistics->document_freqs.find(word);
+		if (document_freq == corpus_statistics->document_freqs.end())
+		{
+			throw std::invalid_argument("Corpus statistics were gathered for another query"s);
+		}
+		return document_freq->second;
+	}
+	return static_cast<int>(word_to_document_freqs_.at(word).postings.size());
 }
@@ -5,6 +5,7 @@
 #include <tuple>
 #include <map>
 #include <set>
+#include <unordered_map>
 #include <deque>
 #include <execution>
 #include <stdexcept>
@@ -13,37 +14,110 @@
 #include <utility>
 #include <vector>
 #include <iterator>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <future>
 
 #include "document.h"
+#include "document_predicates.h"
 #include "string_processing.h"
 #include "concurrent_map.h"
+#include "word_frequencies.h"
+#include "index_stats.h"
+#include "instrumentation.h"
+#include "corpus_statistics.h"
+#include "near_duplicates.h"
+#include "document_positions.h"
+#include "scoring.h"
+#include "fuzzy_index.h"
+#include "facets.h"
+#include "query_log.h"
 
 const static int MAX_RESULT_DOCUMENT_COUNT = 5;
 const static double EPSILON = 1e-6;
 const static size_t MAX_BUCKET_MAP_COUNT = 10;
+//ordinal ranges the parallel term merge splits the documents into
+const static size_t TERM_MERGE_CHUNK_COUNT = 16;
+//a prefix* plus term is expanded to at most this many dictionary terms, the most frequent ones
+const static size_t MAX_PREFIX_EXPANSION_COUNT = 256;
+//removed documents keep their ordinal slots until they are more than this fraction of all slots
+const static double MAX_REMOVED_DOCUMENT_FRACTION = 0.5;
 
 class SearchServer {
 private:
 	struct DocumentData {
+		int id;
 		int rating;
 		DocumentStatus status;
+		size_t storage_bytes;
+		uint32_t length;
+	};
+	struct Posting {
+		uint32_t ordinal;
+		uint32_t count;
+	};
+	struct TermPostings {
+		uint32_t term_id;
+		std::vector<Posting> postings;
 	};
 	std::deque<std::string> storage_;
+	//owners of document texts that were indexed without a copy
+	std::vector<std::shared_ptr<const void>> external_storage_;
 	const std::set<std::string, std::less<>> stop_words_;
-	std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-	std::map<int, std::map<std::string_view, double>> id_to_document_word_;
-	std::map<int, struct DocumentData> documents_;
-	std::set<int> document_ids_;
+	//posting lists are sorted by ordinal; ordinals only grow, so AddDocument appends to them
+	std::map<std::string_view, TermPostings> word_to_document_freqs_;
+	//text of every live term by id; a term leaves the dictionary with its last posting and its id is reused
+	std::vector<std::string_view> terms_;
+	std::vector<uint32_t> free_term_ids_;
+
+	//per-document data is indexed by a dense ordinal assigned in AddDocument order; removed documents leave
+	//tombstone slots until CompactDocuments renumbers the live ones
+	std::unordered_map<int, uint32_t> ordinals_;
+	std::vector<DocumentData> documents_;
+	//entries are sorted by term text
+	std::vector<std::vector<TermFrequency>> document_words_;
+	//kept sorted; ids usually arrive ascending, so inserting is an append
+	std::vector<int> document_ids_;
+
+	size_t posting_count_ = 0;
+	uint64_t total_document_length_ = 0;
+	size_t storage_bytes_ = 0;
+	size_t dead_storage_bytes_ = 0;
+	std::array<size_t, POSTING_HISTOGRAM_SIZE> posting_length_histogram_{};
+
+	std::unique_ptr<NearDuplicateDetector> near_duplicate_detector_;
+
+	bool store_positions_ = false;
+	std::vector<DocumentPositions> document_positions_;
+	size_t positions_bytes_ = 0;
+
+	std::unique_ptr<FuzzyIndex> fuzzy_index_;
+
+	std::unique_ptr<QueryLog> query_log_;
 
 	struct QueryWord {
 		std::string_view data;
 		bool is_minus;
 		bool is_stop;
+		bool is_prefix;
 	};
 
 	struct Query {
 		std::vector<std::string_view> plus_words;
 		std::vector<std::string_view> minus_words;
+		std::vector<std::vector<std::string_view>> phrases;
+		std::vector<std::string_view> plus_prefixes;
+		std::vector<std::string_view> minus_prefixes;
+	};
+
+	using PostingIterator = std::map<std::string_view, TermPostings>::const_iterator;
+
+	struct PrefixExpansion {
+		//local terms among the chosen expansions
+		std::vector<PostingIterator> terms;
+		//sum over the chosen expansions, capped at the document count
+		int document_freq = 0;
 	};
 
 public:
@@ -53,12 +127,47 @@ public:
 	explicit SearchServer(const std::string_view stop_words_text);
 	explicit SearchServer(const std::string& stop_words_text);
 
-	std::set<int>::iterator begin();
+	std::vector<int>::const_iterator begin() const;
 
-	std::set<int>::iterator end();
+	std::vector<int>::const_iterator end() const;
 
 	void AddDocument(int, const std::string_view, DocumentStatus, const std::vector<int>&);
 
+	//tokenized document; preparing only reads the server, so it may run on other threads while documents are added
+	struct PreparedDocument {
+		int id;
+		DocumentStatus status;
+		int rating;
+		std::vector<std::string_view> words;
+		//empty unless the preparing server detects near duplicates
+		NearDuplicateDetector::Sketch sketch;
+		size_t text_bytes;
+	};
+	PreparedDocument PrepareDocument(int, const std::string_view, DocumentStatus, const std::vector<int>&) const;
+
+	//indexes the words in place: their text has to stay valid while text_owner is alive, and the server keeps text_owner;
+	//the text counts as storage although it is not copied
+	void AddPreparedDocument(PreparedDocument document, std::shared_ptr<const void> text_owner);
+
+	//sketches existing and new documents; with options.reject AddDocument throws on near duplicates
+	void EnableNearDuplicateDetection(const NearDuplicateOptions& options = {});
+	std::vector<std::pair<int, double>> FindNearDuplicates(int document_id) const;
+
+	//records word positions of documents added afterwards and enables "quoted phrase" query terms; the server must be empty
+	void EnablePositionalIndex();
+
+	//plus words missing from the index are replaced by the closest live terms within the edit distance;
+	//given CorpusStatistics, missing words and their replacements are taken from the statistics of all shards
+	void EnableFuzzyMatching(const FuzzyMatchingOptions& options = {});
+
+	//counts the indexed plus words of every FindTopDocuments query from now on
+	void EnableQueryLog();
+	//the most frequently queried terms, most frequent first
+	std::vector<HotTerm> GetHotTerms(size_t max_count) const;
+	//reads the postings and document data of the given terms on a background thread so their pages are resident
+	//before traffic arrives; queries may run meanwhile, but the server must not be modified until the future is ready
+	std::future<WarmupResult> WarmUp(std::vector<HotTerm> hot_terms) const;
+
 	template <typename DocumentPredicate, typename ExecutionPolicy>
 	std::vector<Document> FindTopDocuments(const ExecutionPolicy&, const std::string_view, DocumentPredicate) const;
 	template <typename DocumentPredicate>
@@ -72,21 +181,76 @@ public:
 	std::vector<Document> FindTopDocuments(const ExecutionPolicy&, const std::string_view) const;
 	std::vector<Document> FindTopDocuments(const std::string_view) const;
 
+	template <typename DocumentPredicate, typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(const ExecutionPolicy&, const std::string_view, DocumentPredicate, const CorpusStatistics&) const;
+
+	//ranks with a scorer from scoring.h, or any type with the same two methods, instead of the default TF-IDF
+	template <typename DocumentPredicate, typename Scorer, typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(const ExecutionPolicy&, const std::string_view, DocumentPredicate, const Scorer&) const;
+	template <typename DocumentPredicate, typename Scorer, typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(const ExecutionPolicy&, const std::string_view, DocumentPredicate, const CorpusStatistics&, const Scorer&) const;
+
+	//the same top documents plus facets of every match, counted in the pass that builds the candidates
+	template <typename DocumentPredicate, typename ExecutionPolicy>
+	SearchResult FindTopDocumentsWithFacets(const ExecutionPolicy&, const std::string_view, DocumentPredicate, const std::vector<int>& rating_boundaries) const;
+	template <typename ExecutionPolicy>
+	SearchResult FindTopDocumentsWithFacets(const ExecutionPolicy&, const std::string_view, DocumentStatus, const std::vector<int>& rating_boundaries) const;
+	//documents of every status
+	template <typename ExecutionPolicy>
+	SearchResult FindTopDocumentsWithFacets(const ExecutionPolicy&, const std::string_view, const std::vector<int>& rating_boundaries) const;
+
 	int GetDocumentCount() const;
 
+	CorpusStatistics GetCorpusStatistics(const std::string_view raw_query) const;
+
+	static bool IsMoreRelevant(const Document&, const Document&);
+
 	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view, int) const;
 	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::sequenced_policy&, const std::string_view, int) const;
 	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::parallel_policy&, const std::string_view, int) const;
 
-	const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+	//words in lexicographic order
+	WordFrequencies GetWordFrequencies(int document_id) const;
+
+	IndexStats GetStats() const;
 
 	void RemoveDocument(int document_id);
 	void RemoveDocument(const std::execution::sequenced_policy&, int document_id);
 	void RemoveDocument(const std::execution::parallel_policy&, int document_id);
 
+	//ids that are not in the index are skipped
+	void RemoveDocuments(const std::vector<int>& document_ids);
+	void RemoveDocuments(const std::execution::sequenced_policy&, const std::vector<int>& document_ids);
+	void RemoveDocuments(const std::execution::parallel_policy&, const std::vector<int>& document_ids);
+
 private:
 	bool IsStopWord(const std::string_view) const;
 
+	void UpdatePostingHistogram(size_t old_length, size_t new_length);
+
+	void IndexDocument(PreparedDocument document, size_t document_storage_bytes);
+
+	TermPostings& GetTermPostings(const std::string_view);
+	void ReleaseTerm(const std::string_view);
+	std::vector<TermFrequency>::const_iterator FindWord(const std::vector<TermFrequency>&, const std::string_view) const;
+	bool HasWord(const std::vector<TermFrequency>&, const std::string_view) const;
+	static bool HasPosting(const std::vector<Posting>&, uint32_t ordinal);
+	bool MatchesPhrases(uint32_t ordinal, const std::vector<std::vector<std::string_view>>&) const;
+	PrefixExpansion ExpandPrefix(const std::string_view prefix, const CorpusStatistics*) const;
+	static std::vector<Posting> MergePrefixPostings(const std::vector<PostingIterator>&);
+	bool HasMinusPrefixMatch(uint32_t ordinal, const Query&) const;
+	//posting lists of the words, null for words the index lacks, then the merged postings of each prefix
+	std::vector<const std::vector<Posting>*> GetScannedPostings(const std::vector<std::string_view>& words, const std::vector<std::vector<Posting>>& prefix_postings) const;
+	//a match counts towards facets once, while scanning the first posting list holding it, unless a minus word, minus prefix
+	//or phrase excludes it. Earlier and minus posting lists are walked with one cursor each alongside the scanned list,
+	//as all of them are in ordinal order; the first cursors.size() lists are checked
+	static bool HasPostingAtCursors(uint32_t ordinal, const std::vector<const std::vector<Posting>*>& postings, std::vector<size_t>& cursors);
+	std::vector<std::string_view> MatchPlusPrefixes(uint32_t ordinal, const Query&) const;
+	void ReleaseDocument(uint32_t ordinal);
+	bool IsLiveOrdinal(uint32_t ordinal) const;
+	void CompactDocuments();
+	void CompactDocumentsIfNeeded();
+
 	static bool IsValidWord(const std::string_view);
 
 	std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view) const;
@@ -98,16 +262,47 @@ private:
 	Query CommonOfParseQuery(const std::string_view) const;
 	Query ParseQuery(const std::execution::sequenced_policy&, const std::string_view) const;
 	Query ParseQuery(const std::execution::parallel_policy&, const std::string_view) const;
-
-	double ComputeWordInverseDocumentFreq(const std::string_view) const;
+	void CorrectPlusWords(Query&, const CorpusStatistics*) const;
+	void RecordQuery(const Query&) const;
+
+	ScoringContext GetScoringContext(const CorpusStatistics*) const;
+	int GetDocumentFreq(const std::string_view, const CorpusStatistics*) const;
+
+	template <typename DocumentPredicate, typename Scorer, typename ExecutionPolicy>
+	std::vector<Document> CommonOfFindTopDocuments(const ExecutionPolicy&, const std::string_view, DocumentPredicate, const CorpusStatistics*, const Scorer&, SearchFacets* = nullptr) const;
+
+	//true for a query of plus and minus words only. Its posting lists are merged in ordinal order, each document is scored
+	//once all its terms are seen, and only the top documents are kept, so no per-document accumulator is built
+	static bool IsTermQuery(const Query&);
+	template <typename DocumentPredicate, typename Scorer>
+	std::vector<Document> FindTermTopDocuments(const std::execution::sequenced_policy&, const Query&, DocumentPredicate, const CorpusStatistics*, const Scorer&) const;
+	template <typename DocumentPredicate, typename Scorer>
+	std::vector<Document> FindTermTopDocuments(const std::execution::parallel_policy&, const Query&, DocumentPredicate, const CorpusStatistics*, const Scorer&) const;
+	//heap of the top documents among ordinals in [first_ordinal, last_ordinal)
+	template <typename DocumentPredicate, typename Scorer>
+	std::vector<Document> MergeTermPostings(const std::vector<const std::vector<Posting>*>& plus_postings, const std::vector<double>& term_weights,
+		const std::vector<const std::vector<Posting>*>& minus_postings, uint32_t first_ordinal, uint32_t last_ordinal,
+		DocumentPredicate, const ScoringContext&, const Scorer&) const;
 
 	template <typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&, const Query&, DocumentPredicate) const;
-	template <typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, const Query&, DocumentPredicate) const;
+	static bool MatchesPredicate(const DocumentPredicate&, const DocumentData&);
+
+	//the MAX_RESULT_DOCUMENT_COUNT most relevant documents, most relevant first
+	template <typename ExecutionPolicy>
+	static void KeepTopDocuments(const ExecutionPolicy&, std::vector<Document>&);
+	//top_documents is a heap of at most MAX_RESULT_DOCUMENT_COUNT documents with the least relevant on top
+	static void PushTopDocument(std::vector<Document>& top_documents, Document document);
 
-	template <typename DocumentPredicate, typename Map>
-	std::vector<Document> CommonOfFindAllDocuments(Map&, const std::vector<std::string_view>&, DocumentPredicate)const;
+	template <typename DocumentPredicate, typename Scorer>
+	std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&, const Query&, DocumentPredicate, const CorpusStatistics*, const Scorer&, SearchFacets*) const;
+	template <typename DocumentPredicate, typename Scorer>
+	std::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, const Query&, DocumentPredicate, const CorpusStatistics*, const Scorer&, SearchFacets*) const;
+
+	template <typename ExecutionPolicy>
+	void CommonOfRemoveDocuments(const ExecutionPolicy&, const std::vector<int>&);
+
+	template <typename Map>
+	std::vector<Document> CommonOfFindAllDocuments(Map& document_to_relevance, const Query&) const;
 };
 
 template <typename StringContainer>
@@ -120,6 +315,18 @@ SearchServer::SearchServer(const StringContainer& stop_words)
 	}
 }
 
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentStatus status) const
+{
+	return SearchServer::FindTopDocuments(policy, raw_query, DocumentStatusIs{ status });
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query) const
+{
+	return SearchServer::FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const
 {
@@ -129,101 +336,432 @@ std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_
 template <typename DocumentPredicate, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate) const
 {
-	SearchServer::Query query = ParseQuery(policy, raw_query);
+	return CommonOfFindTopDocuments(policy, raw_query, document_predicate, nullptr, TfIdfScorer{});
+}
+
+template <typename DocumentPredicate, typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate, const CorpusStatistics& corpus_statistics) const
+{
+	return CommonOfFindTopDocuments(policy, raw_query, document_predicate, &corpus_statistics, TfIdfScorer{});
+}
 
-	std::vector<Document> matched_documents = FindAllDocuments(policy, query, document_predicate);
+template <typename DocumentPredicate, typename Scorer, typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate, const Scorer& scorer) const
+{
+	return CommonOfFindTopDocuments(policy, raw_query, document_predicate, nullptr, scorer);
+}
 
-	sort(policy, matched_documents.begin(), matched_documents.end(),
-		[](const Document& lhs, const Document& rhs) {
-			if (std::abs(lhs.relevance - rhs.relevance) < EPSILON)
-			{
-				return lhs.rating > rhs.rating;
-			}
-			else
-			{
-				return lhs.relevance > rhs.relevance;
-			}
-		});
+template <typename DocumentPredicate, typename Scorer, typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate, const CorpusStatistics& corpus_statistics, const Scorer& scorer) const
+{
+	return CommonOfFindTopDocuments(policy, raw_query, document_predicate, &corpus_statistics, scorer);
+}
+
+template <typename DocumentPredicate, typename ExecutionPolicy>
+SearchResult SearchServer::FindTopDocumentsWithFacets(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate, const std::vector<int>& rating_boundaries) const
+{
+	SearchResult result;
+	result.facets = SearchFacets(rating_boundaries);
+	result.documents = CommonOfFindTopDocuments(policy, raw_query, document_predicate, nullptr, TfIdfScorer{}, &result.facets);
+	return result;
+}
+
+template <typename ExecutionPolicy>
+SearchResult SearchServer::FindTopDocumentsWithFacets(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentStatus status, const std::vector<int>& rating_boundaries) const
+{
+	return FindTopDocumentsWithFacets(policy, raw_query, DocumentStatusIs{ status }, rating_boundaries);
+}
 
-	if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT)
+template <typename ExecutionPolicy>
+SearchResult SearchServer::FindTopDocumentsWithFacets(const ExecutionPolicy& policy, const std::string_view raw_query, const std::vector<int>& rating_boundaries) const
+{
+	return FindTopDocumentsWithFacets(policy, raw_query, AcceptAllDocuments{}, rating_boundaries);
+}
+
+template <typename DocumentPredicate, typename Scorer, typename ExecutionPolicy>
+std::vector<Document> SearchServer::CommonOfFindTopDocuments(const ExecutionPolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate, const CorpusStatistics* corpus_statistics, const Scorer& scorer, SearchFacets* facets) const
+{
+	SearchServer::Query query;
 	{
-		matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+		INSTRUMENT_STAGE(Stage::PARSE);
+		query = ParseQuery(policy, raw_query);
+		if (fuzzy_index_)
+		{
+			CorrectPlusWords(query, corpus_statistics);
+		}
 	}
+	if (query_log_)
+	{
+		RecordQuery(query);
+	}
+
+	if (facets == nullptr && IsTermQuery(query))
+	{
+		return FindTermTopDocuments(policy, query, document_predicate, corpus_statistics, scorer);
+	}
+
+	std::vector<Document> matched_documents = FindAllDocuments(policy, query, document_predicate, corpus_statistics, scorer, facets);
 
+	INSTRUMENT_STAGE(Stage::SORT);
+	KeepTopDocuments(policy, matched_documents);
 	return matched_documents;
 }
 
-
+template <typename ExecutionPolicy>
+void SearchServer::KeepTopDocuments(const ExecutionPolicy& policy, std::vector<Document>& documents)
+{
+	if constexpr (std::is_same_v<ExecutionPolicy, std::execution::parallel_policy>)
+	{
+		const size_t result_count = std::min(documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+		std::partial_sort(policy, documents.begin(), documents.begin() + result_count, documents.end(), IsMoreRelevant);
+		documents.resize(result_count);
+	}
+	else
+	{
+		//the same heap as the term merge, so that both rank documents whose relevances differ by less than EPSILON alike
+		std::vector<Document> top_documents;
+		top_documents.reserve(std::min(documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT)));
+		for (Document& document : documents)
+		{
+			PushTopDocument(top_documents, std::move(document));
+		}
+		std::sort_heap(top_documents.begin(), top_documents.end(), IsMoreRelevant);
+		documents = std::move(top_documents);
+	}
+}
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy& policy, const Query& query, DocumentPredicate document_predicate) const
+bool SearchServer::MatchesPredicate(const DocumentPredicate& document_predicate, const DocumentData& document_data)
 {
-	std::map<int, double> document_to_relevance;
-	for (const std::string_view word : query.plus_words)
+	if constexpr (std::is_same_v<DocumentPredicate, AcceptAllDocuments>)
 	{
-		if (word_to_document_freqs_.count(word) != 0)
+		return true;
+	}
+	else if constexpr (std::is_same_v<DocumentPredicate, DocumentStatusIs>)
+	{
+		return document_data.status == document_predicate.status;
+	}
+	else
+	{
+		return document_predicate(document_data.id, document_data.status, document_data.rating);
+	}
+}
+
+template <typename DocumentPredicate, typename Scorer>
+std::vector<Document> SearchServer::FindTermTopDocuments(const std::execution::sequenced_policy&, const Query& query, DocumentPredicate document_predicate, const CorpusStatistics* corpus_statistics, const Scorer& scorer) const
+{
+	const ScoringContext scoring_context = GetScoringContext(corpus_statistics);
+	const std::vector<const std::vector<Posting>*> plus_postings = GetScannedPostings(query.plus_words, {});
+	//words the index lacks have no postings to weigh
+	std::vector<double> term_weights(query.plus_words.size());
+	for (size_t i = 0; i < term_weights.size(); ++i)
+	{
+		if (plus_postings[i] != nullptr)
+		{
+			term_weights[i] = scorer.ComputeTermWeight(scoring_context, GetDocumentFreq(query.plus_words[i], corpus_statistics));
+		}
+	}
+
+	std::vector<Document> top_documents;
+	{
+		INSTRUMENT_STAGE(Stage::POSTINGS_SCAN);
+		top_documents = MergeTermPostings(plus_postings, term_weights, GetScannedPostings(query.minus_words, {}),
+			0, static_cast<uint32_t>(documents_.size()), document_predicate, scoring_context, scorer);
+	}
+
+	//matches come in ordinal order as in the sequential general path, and go through the same heap
+	INSTRUMENT_STAGE(Stage::SORT);
+	std::sort_heap(top_documents.begin(), top_documents.end(), IsMoreRelevant);
+	return top_documents;
+}
+
+template <typename DocumentPredicate, typename Scorer>
+std::vector<Document> SearchServer::FindTermTopDocuments(const std::execution::parallel_policy& policy, const Query& query, DocumentPredicate document_predicate, const CorpusStatistics* corpus_statistics, const Scorer& scorer) const
+{
+	const ScoringContext scoring_context = GetScoringContext(corpus_statistics);
+	//repeated plus words count once, as in the parallel general path
+	std::vector<std::string_view> plus_query(query.plus_words.begin(), query.plus_words.end());
+	std::sort(plus_query.begin(), plus_query.end());
+	plus_query.erase(std::unique(plus_query.begin(), plus_query.end()), plus_query.end());
+	const std::vector<const std::vector<Posting>*> plus_postings = GetScannedPostings(plus_query, {});
+	const std::vector<const std::vector<Posting>*> minus_postings = GetScannedPostings(query.minus_words, {});
+	//words the index lacks have no postings to weigh
+	std::vector<double> term_weights(plus_query.size());
+	for (size_t i = 0; i < term_weights.size(); ++i)
+	{
+		if (plus_postings[i] != nullptr)
 		{
-			const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-			for (const auto& [document_id, term_freq] : word_to_document_freqs_.at(word))
+			term_weights[i] = scorer.ComputeTermWeight(scoring_context, GetDocumentFreq(plus_query[i], corpus_statistics));
+		}
+	}
+
+	//every chunk of the ordinal range is merged into its own heap, and the heaps are merged in chunk order,
+	//so the result does not depend on the thread count
+	std::vector<std::vector<Document>> chunk_top_documents(TERM_MERGE_CHUNK_COUNT);
+	{
+		INSTRUMENT_STAGE(Stage::POSTINGS_SCAN);
+		const size_t chunk_size = (documents_.size() + TERM_MERGE_CHUNK_COUNT - 1) / TERM_MERGE_CHUNK_COUNT;
+		std::vector<size_t> chunks(TERM_MERGE_CHUNK_COUNT);
+		std::iota(chunks.begin(), chunks.end(), 0);
+		std::transform(policy, chunks.begin(), chunks.end(), chunk_top_documents.begin(), [&](const size_t chunk)
 			{
-				const auto& document_data = documents_.at(document_id);
-				if (document_predicate(document_id, document_data.status, document_data.rating))
+				const size_t first_ordinal = std::min(chunk * chunk_size, documents_.size());
+				const size_t last_ordinal = std::min(first_ordinal + chunk_size, documents_.size());
+				return MergeTermPostings(plus_postings, term_weights, minus_postings,
+					static_cast<uint32_t>(first_ordinal), static_cast<uint32_t>(last_ordinal), document_predicate, scoring_context, scorer);
+			});
+	}
+
+	INSTRUMENT_STAGE(Stage::SORT);
+	std::vector<Document> top_documents;
+	for (std::vector<Document>& documents : chunk_top_documents)
+	{
+		for (Document& document : documents)
+		{
+			PushTopDocument(top_documents, std::move(document));
+		}
+	}
+	std::sort_heap(top_documents.begin(), top_documents.end(), IsMoreRelevant);
+	return top_documents;
+}
+
+template <typename DocumentPredicate, typename Scorer>
+std::vector<Document> SearchServer::MergeTermPostings(const std::vector<const std::vector<Posting>*>& plus_postings, const std::vector<double>& term_weights,
+	const std::vector<const std::vector<Posting>*>& minus_postings, uint32_t first_ordinal, uint32_t last_ordinal,
+	DocumentPredicate document_predicate, const ScoringContext& scoring_context, const Scorer& scorer) const
+{
+	//the postings of every list in [first_ordinal, last_ordinal); lists of words the index lacks are empty ranges
+	std::vector<const Posting*> cursors(plus_postings.size());
+	std::vector<const Posting*> ends(plus_postings.size());
+	size_t scanned_count = 0;
+	for (size_t i = 0; i < plus_postings.size(); ++i)
+	{
+		if (plus_postings[i] == nullptr)
+		{
+			continue;
+		}
+		const auto by_ordinal = [](const Posting& lhs, uint32_t rhs) { return lhs.ordinal < rhs; };
+		const std::vector<Posting>& posting = *plus_postings[i];
+		cursors[i] = posting.data() + (std::lower_bound(posting.begin(), posting.end(), first_ordinal, by_ordinal) - posting.begin());
+		ends[i] = posting.data() + (std::lower_bound(posting.begin(), posting.end(), last_ordinal, by_ordinal) - posting.begin());
+		scanned_count += ends[i] - cursors[i];
+	}
+	std::vector<size_t> minus_cursors(minus_postings.size());
+	for (size_t i = 0; i < minus_postings.size(); ++i)
+	{
+		if (minus_postings[i] != nullptr)
+		{
+			minus_cursors[i] = std::lower_bound(minus_postings[i]->begin(), minus_postings[i]->end(), first_ordinal, [](const Posting& lhs, uint32_t rhs)
+				{ return lhs.ordinal < rhs; }) - minus_postings[i]->begin();
+		}
+	}
+	INSTRUMENT_COUNT(Counter::POSTINGS_SCANNED, scanned_count);
+
+	//documents are visited in ordinal order and their scores summed in plus word order, as the accumulator of the
+	//general path sums them
+	std::vector<Document> top_documents;
+	top_documents.reserve(MAX_RESULT_DOCUMENT_COUNT);
+	size_t scored_count = 0;
+	//one list needs no merge: every document occurs in it once
+	if (cursors.size() == 1 && minus_postings.empty())
+	{
+		for (; cursors[0] != ends[0]; ++cursors[0])
+		{
+			const DocumentData& document_data = documents_[cursors[0]->ordinal];
+			if (MatchesPredicate(document_predicate, document_data))
+			{
+				PushTopDocument(top_documents, { document_data.id, scorer.Score(scoring_context, term_weights[0], cursors[0]->count, document_data.length), document_data.rating });
+				++scored_count;
+			}
+		}
+	}
+	while (true)
+	{
+		uint32_t ordinal = last_ordinal;
+		for (size_t i = 0; i < cursors.size(); ++i)
+		{
+			if (cursors[i] != ends[i])
+			{
+				ordinal = std::min(ordinal, cursors[i]->ordinal);
+			}
+		}
+		if (ordinal == last_ordinal)
+		{
+			break;
+		}
+
+		const DocumentData& document_data = documents_[ordinal];
+		const bool matches = MatchesPredicate(document_predicate, document_data);
+		double relevance = 0.0;
+		for (size_t i = 0; i < cursors.size(); ++i)
+		{
+			if (cursors[i] != ends[i] && cursors[i]->ordinal == ordinal)
+			{
+				if (matches)
+				{
+					relevance += scorer.Score(scoring_context, term_weights[i], cursors[i]->count, document_data.length);
+				}
+				++cursors[i];
+			}
+		}
+		if (matches && !HasPostingAtCursors(ordinal, minus_postings, minus_cursors))
+		{
+			PushTopDocument(top_documents, { document_data.id, relevance, document_data.rating });
+			++scored_count;
+		}
+	}
+	INSTRUMENT_COUNT(Counter::DOCUMENTS_SCORED, scored_count);
+	return top_documents;
+}
+
+template <typename DocumentPredicate, typename Scorer>
+std::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy& policy, const Query& query, DocumentPredicate document_predicate, const CorpusStatistics* corpus_statistics, const Scorer& scorer, SearchFacets* facets) const
+{
+	std::map<uint32_t, double> document_to_relevance;
+	const ScoringContext scoring_context = GetScoringContext(corpus_statistics);
+	{
+		INSTRUMENT_STAGE(Stage::POSTINGS_SCAN);
+		//the expansions of a prefix are scored as one term, its count and document frequency are the sums of theirs
+		std::vector<PrefixExpansion> expansions;
+		std::vector<std::vector<Posting>> prefix_postings;
+		for (const std::string_view prefix : query.plus_prefixes)
+		{
+			expansions.push_back(ExpandPrefix(prefix, corpus_statistics));
+			prefix_postings.push_back(MergePrefixPostings(expansions.back().terms));
+		}
+		const std::vector<const std::vector<Posting>*> scanned_postings = GetScannedPostings(query.plus_words, prefix_postings);
+		const std::vector<const std::vector<Posting>*> minus_postings = GetScannedPostings(query.minus_words, {});
+
+		for (size_t position = 0; position < scanned_postings.size(); ++position)
+		{
+			if (scanned_postings[position] == nullptr || scanned_postings[position]->empty())
+			{
+				continue;
+			}
+			const int document_freq = position < query.plus_words.size() ?
+				GetDocumentFreq(query.plus_words[position], corpus_statistics)
+				: expansions[position - query.plus_words.size()].document_freq;
+			const double term_weight = scorer.ComputeTermWeight(scoring_context, document_freq);
+			INSTRUMENT_COUNT(Counter::POSTINGS_SCANNED, scanned_postings[position]->size());
+			std::vector<size_t> earlier_cursors(facets != nullptr ? position : 0);
+			std::vector<size_t> minus_cursors(facets != nullptr ? minus_postings.size() : 0);
+			for (const auto& [ordinal, term_count] : *scanned_postings[position])
+			{
+				const DocumentData& document_data = documents_[ordinal];
+				if (MatchesPredicate(document_predicate, document_data))
 				{
-					document_to_relevance[document_id] += term_freq * inverse_document_freq;
+					document_to_relevance[ordinal] += scorer.Score(scoring_context, term_weight, term_count, document_data.length);
+				}
+				if (facets != nullptr && !HasPostingAtCursors(ordinal, scanned_postings, earlier_cursors)
+					&& !HasPostingAtCursors(ordinal, minus_postings, minus_cursors)
+					&& !HasMinusPrefixMatch(ordinal, query) && MatchesPhrases(ordinal, query.phrases))
+				{
+					facets->Add(document_data.status, document_data.rating);
 				}
 			}
 		}
 	}
 
-	return CommonOfFindAllDocuments(document_to_relevance, query.minus_words, document_predicate);
+	return CommonOfFindAllDocuments(document_to_relevance, query);
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy& policy, const Query& query, DocumentPredicate document_predicate) const {
-	ConcurrentMap<int, double> document_to_relevance(MAX_BUCKET_MAP_COUNT);
+template <typename DocumentPredicate, typename Scorer>
+std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy& policy, const Query& query, DocumentPredicate document_predicate, const CorpusStatistics* corpus_statistics, const Scorer& scorer, SearchFacets* facets) const {
+	ConcurrentMap<uint32_t, double> document_to_relevance(MAX_BUCKET_MAP_COUNT);
+	const ScoringContext scoring_context = GetScoringContext(corpus_statistics);
 
 	std::vector<std::string_view> plus_query(query.plus_words.begin(), query.plus_words.end());
 	std::sort(plus_query.begin(), plus_query.end());
 	plus_query.erase(std::unique(plus_query.begin(), plus_query.end()), plus_query.end());
 
-	std::for_each(policy, plus_query.begin(), plus_query.end(), [&](const std::string_view word)
+	{
+		INSTRUMENT_STAGE(Stage::POSTINGS_SCAN);
+		//every prefix is expanded and merged before the scan, so that facets can tell which posting lists come first
+		std::vector<PrefixExpansion> expansions(query.plus_prefixes.size());
+		std::transform(policy, query.plus_prefixes.begin(), query.plus_prefixes.end(), expansions.begin(), [&](const std::string_view prefix)
+			{ return ExpandPrefix(prefix, corpus_statistics); });
+		std::vector<std::vector<Posting>> prefix_postings(expansions.size());
+		std::transform(policy, expansions.begin(), expansions.end(), prefix_postings.begin(), [](const PrefixExpansion& expansion)
+			{ return MergePrefixPostings(expansion.terms); });
+		const std::vector<const std::vector<Posting>*> scanned_postings = GetScannedPostings(plus_query, prefix_postings);
+		const std::vector<const std::vector<Posting>*> minus_postings = GetScannedPostings(query.minus_words, {});
+
+		//each scanned posting list counts into its own facets, merged once the scan is done
+		std::vector<SearchFacets> scan_facets;
+		if (facets != nullptr)
 		{
-			if (word_to_document_freqs_.count(word) != 0)
+			scan_facets.assign(scanned_postings.size(), SearchFacets(facets->rating_boundaries));
+		}
+
+		std::vector<size_t> positions(scanned_postings.size());
+		std::iota(positions.begin(), positions.end(), 0);
+		std::for_each(policy, positions.begin(), positions.end(), [&](const size_t position)
 			{
-				const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-				for (const auto& [document_id, term_freq] : word_to_document_freqs_.at(word))
+				if (scanned_postings[position] == nullptr || scanned_postings[position]->empty())
 				{
-					const auto& document_data = documents_.at(document_id);
-					if (document_predicate(document_id, document_data.status, document_data.rating))
+					return;
+				}
+				const int document_freq = position < plus_query.size() ?
+					GetDocumentFreq(plus_query[position], corpus_statistics)
+					: expansions[position - plus_query.size()].document_freq;
+				const double term_weight = scorer.ComputeTermWeight(scoring_context, document_freq);
+				INSTRUMENT_COUNT(Counter::POSTINGS_SCANNED, scanned_postings[position]->size());
+				std::vector<size_t> earlier_cursors(facets != nullptr ? position : 0);
+				std::vector<size_t> minus_cursors(facets != nullptr ? minus_postings.size() : 0);
+				for (const auto& [ordinal, term_count] : *scanned_postings[position])
+				{
+					const DocumentData& document_data = documents_[ordinal];
+					if (MatchesPredicate(document_predicate, document_data))
+					{
+						document_to_relevance[ordinal].ref_to_value += scorer.Score(scoring_context, term_weight, term_count, document_data.length);
+					}
+					if (facets != nullptr && !HasPostingAtCursors(ordinal, scanned_postings, earlier_cursors)
+						&& !HasPostingAtCursors(ordinal, minus_postings, minus_cursors)
+						&& !HasMinusPrefixMatch(ordinal, query) && MatchesPhrases(ordinal, query.phrases))
 					{
-						document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
+						scan_facets[position].Add(document_data.status, document_data.rating);
 					}
 				}
-			}
-		});
+			});
 
-	return CommonOfFindAllDocuments(document_to_relevance, query.minus_words, document_predicate);
+		for (const SearchFacets& position_facets : scan_facets)
+		{
+			facets->Merge(position_facets);
+		}
+	}
+
+	return CommonOfFindAllDocuments(document_to_relevance, query);
 }
 
-template <typename DocumentPredicate, typename Map>
-std::vector<Document> SearchServer::CommonOfFindAllDocuments(Map& document_to_relevance, const std::vector<std::string_view>& minus_query, DocumentPredicate document_predicate) const
+template <typename Map>
+std::vector<Document> SearchServer::CommonOfFindAllDocuments(Map& document_to_relevance, const Query& query) const
 {
-	std::for_each(minus_query.begin(), minus_query.end(), [&](const std::string_view word)
-		{
-			if (word_to_document_freqs_.count(word) != 0)
+	{
+		INSTRUMENT_STAGE(Stage::MINUS_FILTER);
+		std::for_each(query.minus_words.begin(), query.minus_words.end(), [&](const std::string_view word)
 			{
-				for (const auto [document_id, _] : word_to_document_freqs_.at(word))
+				if (word_to_document_freqs_.count(word) != 0)
 				{
-					document_to_relevance.erase(document_id);
+					for (const auto [ordinal, _] : word_to_document_freqs_.at(word).postings)
+					{
+						document_to_relevance.erase(ordinal);
+					}
 				}
-			}
-		});
+			});
+	}
 
 	std::vector<Document> matched_documents;
-	for (const auto& [document_id, relevance] : document_to_relevance)
+	for (const auto& [ordinal, relevance] : document_to_relevance)
 	{
-		matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+		//minus prefixes are looked up in the forward index of each match instead of scanning every posting list they expand to
+		if (HasMinusPrefixMatch(ordinal, query) || !MatchesPhrases(ordinal, query.phrases))
+		{
+			continue;
+		}
+		const DocumentData& document_data = documents_[ordinal];
+		matched_documents.push_back({ document_data.id, relevance, document_data.rating });
 	}
+	INSTRUMENT_COUNT(Counter::DOCUMENTS_SCORED, matched_documents.size());
 
 	return matched_documents;
 }
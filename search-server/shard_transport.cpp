@@ -0,0 +1,509 @@
+#include "shard_transport.h"
+
+#include <cstring>
+#include <exception>
+#include <future>
+#include <stdexcept>
+
+#ifdef __unix__
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace std::literals;
+
+InProcessShard::InProcessShard(const std::string& stop_words_text)
+	: search_server_(stop_words_text)
+{
+}
+
+void InProcessShard::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings)
+{
+	search_server_.AddDocument(document_id, document, status, ratings);
+}
+
+void InProcessShard::RemoveDocument(int document_id)
+{
+	search_server_.RemoveDocument(document_id);
+}
+
+int InProcessShard::GetDocumentCount()
+{
+	return search_server_.GetDocumentCount();
+}
+
+CorpusStatistics InProcessShard::GetCorpusStatistics(std::string_view raw_query)
+{
+	return search_server_.GetCorpusStatistics(raw_query);
+}
+
+std::vector<Document> InProcessShard::FindTopDocuments(std::string_view raw_query, DocumentStatus status, const CorpusStatistics& corpus_statistics)
+{
+	return search_server_.FindTopDocuments(std::execution::seq, raw_query, [status]([[maybe_unused]] int document_id, DocumentStatus document_status, [[maybe_unused]] int rating)
+		{ return document_status == status; }, corpus_statistics);
+}
+
+std::vector<std::unique_ptr<ShardTransport>> MakeInProcessShards(const std::string& stop_words_text, size_t shard_count)
+{
+	std::vector<std::unique_ptr<ShardTransport>> shards;
+	for (size_t i = 0; i < shard_count; ++i)
+	{
+		shards.push_back(std::make_unique<InProcessShard>(stop_words_text));
+	}
+	return shards;
+}
+
+#ifdef __unix__
+
+enum class ShardCommand : uint8_t {
+	ADD_DOCUMENT,
+	REMOVE_DOCUMENT,
+	GET_DOCUMENT_COUNT,
+	GET_CORPUS_STATISTICS,
+	FIND_TOP_DOCUMENTS
+};
+
+enum class ShardReply : uint8_t {
+	OK,
+	INVALID_ARGUMENT,
+	OUT_OF_RANGE,
+	ERROR
+};
+
+//both ends live on the same host, so values are sent in native byte order
+class MessageWriter {
+public:
+	template <typename T>
+	MessageWriter& Write(T value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		data_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+		return *this;
+	}
+
+	MessageWriter& WriteString(std::string_view text)
+	{
+		Write(static_cast<uint64_t>(text.size()));
+		data_.append(text);
+		return *this;
+	}
+
+	const std::string& GetData() const
+	{
+		return data_;
+	}
+
+private:
+	std::string data_;
+};
+
+class MessageReader {
+public:
+	explicit MessageReader(std::string_view data) : data_(data)
+	{
+	}
+
+	template <typename T>
+	T Read()
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		if (data_.size() < sizeof(T))
+		{
+			throw std::runtime_error("Truncated shard message"s);
+		}
+		T value;
+		std::memcpy(&value, data_.data(), sizeof(T));
+		data_.remove_prefix(sizeof(T));
+		return value;
+	}
+
+	//an element count, checked against the bytes left so a corrupt count cannot trigger a huge allocation
+	size_t ReadCount(size_t element_size)
+	{
+		const uint64_t count = Read<uint64_t>();
+		if (count > data_.size() / element_size)
+		{
+			throw std::runtime_error("Truncated shard message"s);
+		}
+		return static_cast<size_t>(count);
+	}
+
+	std::string_view ReadString()
+	{
+		const size_t size = static_cast<size_t>(Read<uint64_t>());
+		if (data_.size() < size)
+		{
+			throw std::runtime_error("Truncated shard message"s);
+		}
+		const std::string_view text = data_.substr(0, size);
+		data_.remove_prefix(size);
+		return text;
+	}
+
+private:
+	std::string_view data_;
+};
+
+static void WriteDocumentFreqs(MessageWriter& writer, const std::map<std::string, int, std::less<>>& document_freqs)
+{
+	writer.Write(static_cast<uint64_t>(document_freqs.size()));
+	for (const auto& [word, document_freq] : document_freqs)
+	{
+		writer.WriteString(word).Write(static_cast<int32_t>(document_freq));
+	}
+}
+
+static void ReadDocumentFreqs(MessageReader& reader, std::map<std::string, int, std::less<>>& document_freqs)
+{
+	const uint64_t word_count = reader.Read<uint64_t>();
+	for (uint64_t i = 0; i < word_count; ++i)
+	{
+		const std::string_view word = reader.ReadString();
+		document_freqs.emplace(word, reader.Read<int32_t>());
+	}
+}
+
+static void WriteCorpusStatistics(MessageWriter& writer, const CorpusStatistics& corpus_statistics)
+{
+	writer.Write(static_cast<int32_t>(corpus_statistics.document_count));
+	writer.Write(corpus_statistics.total_document_length);
+	WriteDocumentFreqs(writer, corpus_statistics.document_freqs);
+}
+
+static CorpusStatistics ReadCorpusStatistics(MessageReader& reader)
+{
+	CorpusStatistics corpus_statistics;
+	corpus_statistics.document_count = reader.Read<int32_t>();
+	corpus_statistics.total_document_length = reader.Read<uint64_t>();
+	ReadDocumentFreqs(reader, corpus_statistics.document_freqs);
+	return corpus_statistics;
+}
+
+//frames carry one document or one query with its statistics, anything larger is a corrupt stream
+const static uint64_t MAX_SHARD_FRAME_SIZE = uint64_t{ 1 } << 30;
+
+static void SendAll(int socket_fd, std::string_view data)
+{
+	while (!data.empty())
+	{
+		const ssize_t sent = send(socket_fd, data.data(), data.size(), MSG_NOSIGNAL);
+		if (sent <= 0)
+		{
+			throw std::runtime_error("Shard connection is closed"s);
+		}
+		data.remove_prefix(static_cast<size_t>(sent));
+	}
+}
+
+static bool ReceiveAll(int socket_fd, char* buffer, size_t size)
+{
+	while (size != 0)
+	{
+		const ssize_t received = recv(socket_fd, buffer, size, 0);
+		if (received <= 0)
+		{
+			return false;
+		}
+		buffer += received;
+		size -= static_cast<size_t>(received);
+	}
+	return true;
+}
+
+static void SendFrame(int socket_fd, const std::string& payload)
+{
+	const uint64_t size = payload.size();
+	if (size > MAX_SHARD_FRAME_SIZE)
+	{
+		throw std::invalid_argument("Shard message is too large"s);
+	}
+	SendAll(socket_fd, std::string_view(reinterpret_cast<const char*>(&size), sizeof(size)));
+	SendAll(socket_fd, payload);
+}
+
+static bool ReceiveFrame(int socket_fd, std::string& payload)
+{
+	uint64_t size = 0;
+	if (!ReceiveAll(socket_fd, reinterpret_cast<char*>(&size), sizeof(size)))
+	{
+		return false;
+	}
+	if (size > MAX_SHARD_FRAME_SIZE)
+	{
+		throw std::runtime_error("Shard frame is too large"s);
+	}
+	payload.resize(static_cast<size_t>(size));
+	return ReceiveAll(socket_fd, payload.data(), payload.size());
+}
+
+static DocumentStatus ReadDocumentStatus(MessageReader& reader)
+{
+	const auto status = reader.Read<std::underlying_type_t<DocumentStatus>>();
+	if (status < static_cast<int>(DocumentStatus::ACTUAL) || status > static_cast<int>(DocumentStatus::REMOVED))
+	{
+		throw std::invalid_argument("Invalid document status in shard message"s);
+	}
+	return static_cast<DocumentStatus>(status);
+}
+
+static std::string HandleShardRequest(std::string_view request, SearchServer& search_server)
+{
+	MessageReader reader(request);
+	MessageWriter writer;
+	writer.Write(ShardReply::OK);
+
+	switch (reader.Read<ShardCommand>())
+	{
+	case ShardCommand::ADD_DOCUMENT:
+	{
+		const int document_id = reader.Read<int32_t>();
+		const std::string_view document = reader.ReadString();
+		const DocumentStatus status = ReadDocumentStatus(reader);
+		std::vector<int> ratings(reader.ReadCount(sizeof(int32_t)));
+		for (int& rating : ratings)
+		{
+			rating = reader.Read<int32_t>();
+		}
+		search_server.AddDocument(document_id, document, status, ratings);
+		break;
+	}
+	case ShardCommand::REMOVE_DOCUMENT:
+		search_server.RemoveDocument(reader.Read<int32_t>());
+		break;
+	case ShardCommand::GET_DOCUMENT_COUNT:
+		writer.Write(static_cast<int32_t>(search_server.GetDocumentCount()));
+		break;
+	case ShardCommand::GET_CORPUS_STATISTICS:
+		WriteCorpusStatistics(writer, search_server.GetCorpusStatistics(reader.ReadString()));
+		break;
+	case ShardCommand::FIND_TOP_DOCUMENTS:
+	{
+		const std::string_view raw_query = reader.ReadString();
+		const DocumentStatus status = ReadDocumentStatus(reader);
+		const CorpusStatistics corpus_statistics = ReadCorpusStatistics(reader);
+		const std::vector<Document> documents = search_server.FindTopDocuments(std::execution::seq, raw_query,
+			[status]([[maybe_unused]] int document_id, DocumentStatus document_status, [[maybe_unused]] int rating)
+			{ return document_status == status; }, corpus_statistics);
+
+		writer.Write(static_cast<uint64_t>(documents.size()));
+		for (const Document& document : documents)
+		{
+			writer.Write(static_cast<int32_t>(document.id)).Write(document.relevance).Write(static_cast<int32_t>(document.rating));
+		}
+		break;
+	}
+	default:
+		throw std::runtime_error("Unknown shard command"s);
+	}
+	return writer.GetData();
+}
+
+void RunShardServer(int socket_fd, SearchServer& search_server)
+{
+	std::string request;
+	while (true)
+	{
+		//a corrupt frame leaves the stream out of sync, so the server replies with the error and stops
+		try
+		{
+			if (!ReceiveFrame(socket_fd, request))
+			{
+				return;
+			}
+		}
+		catch (const std::exception& e)
+		{
+			try
+			{
+				SendFrame(socket_fd, MessageWriter().Write(ShardReply::ERROR).WriteString(e.what()).GetData());
+			}
+			catch (const std::exception&)
+			{
+			}
+			return;
+		}
+
+		std::string response;
+		try
+		{
+			response = HandleShardRequest(request, search_server);
+		}
+		catch (const std::invalid_argument& e)
+		{
+			response = MessageWriter().Write(ShardReply::INVALID_ARGUMENT).WriteString(e.what()).GetData();
+		}
+		catch (const std::out_of_range& e)
+		{
+			response = MessageWriter().Write(ShardReply::OUT_OF_RANGE).WriteString(e.what()).GetData();
+		}
+		catch (const std::exception& e)
+		{
+			response = MessageWriter().Write(ShardReply::ERROR).WriteString(e.what()).GetData();
+		}
+
+		//the client is gone, there is nobody left to serve
+		try
+		{
+			SendFrame(socket_fd, response);
+		}
+		catch (const std::exception&)
+		{
+			return;
+		}
+	}
+}
+
+LocalSocketShard::LocalSocketShard(const std::string& stop_words_text)
+{
+	int socket_fds[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, socket_fds) != 0)
+	{
+		throw std::runtime_error("Cannot create shard socket pair"s);
+	}
+	socket_fd_ = socket_fds[0];
+
+	const int server_fd = socket_fds[1];
+	//an exception must not escape the thread, a server that cannot be created is reported to this constructor
+	std::promise<void> started;
+	std::future<void> start_result = started.get_future();
+	server_thread_ = std::thread([server_fd, stop_words_text, started = std::move(started)]() mutable
+		{
+			std::unique_ptr<SearchServer> search_server;
+			try
+			{
+				search_server = std::make_unique<SearchServer>(stop_words_text);
+				started.set_value();
+			}
+			catch (...)
+			{
+				started.set_exception(std::current_exception());
+			}
+			if (search_server)
+			{
+				RunShardServer(server_fd, *search_server);
+			}
+			close(server_fd);
+		});
+
+	try
+	{
+		start_result.get();
+	}
+	catch (...)
+	{
+		server_thread_.join();
+		close(socket_fd_);
+		throw;
+	}
+}
+
+LocalSocketShard::LocalSocketShard(int socket_fd)
+	: socket_fd_(socket_fd)
+{
+}
+
+LocalSocketShard::~LocalSocketShard()
+{
+	shutdown(socket_fd_, SHUT_RDWR);
+	if (server_thread_.joinable())
+	{
+		server_thread_.join();
+	}
+	close(socket_fd_);
+}
+
+std::string LocalSocketShard::Exchange(const std::string& request)
+{
+	std::string response;
+	{
+		std::lock_guard guard(exchange_mutex_);
+		SendFrame(socket_fd_, request);
+		if (!ReceiveFrame(socket_fd_, response))
+		{
+			throw std::runtime_error("Shard connection is closed"s);
+		}
+	}
+
+	MessageReader reader(response);
+	const ShardReply reply = reader.Read<ShardReply>();
+	if (reply == ShardReply::OK)
+	{
+		return response;
+	}
+
+	const std::string message(reader.ReadString());
+	if (reply == ShardReply::INVALID_ARGUMENT)
+	{
+		throw std::invalid_argument(message);
+	}
+	if (reply == ShardReply::OUT_OF_RANGE)
+	{
+		throw std::out_of_range(message);
+	}
+	throw std::runtime_error(message);
+}
+
+void LocalSocketShard::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings)
+{
+	MessageWriter writer;
+	writer.Write(ShardCommand::ADD_DOCUMENT).Write(static_cast<int32_t>(document_id)).WriteString(document).Write(status);
+	writer.Write(static_cast<uint64_t>(ratings.size()));
+	for (const int rating : ratings)
+	{
+		writer.Write(static_cast<int32_t>(rating));
+	}
+	Exchange(writer.GetData());
+}
+
+void LocalSocketShard::RemoveDocument(int document_id)
+{
+	Exchange(MessageWriter().Write(ShardCommand::REMOVE_DOCUMENT).Write(static_cast<int32_t>(document_id)).GetData());
+}
+
+int LocalSocketShard::GetDocumentCount()
+{
+	const std::string response = Exchange(MessageWriter().Write(ShardCommand::GET_DOCUMENT_COUNT).GetData());
+	MessageReader reader(response);
+	reader.Read<ShardReply>();
+	return reader.Read<int32_t>();
+}
+
+CorpusStatistics LocalSocketShard::GetCorpusStatistics(std::string_view raw_query)
+{
+	const std::string response = Exchange(MessageWriter().Write(ShardCommand::GET_CORPUS_STATISTICS).WriteString(raw_query).GetData());
+	MessageReader reader(response);
+	reader.Read<ShardReply>();
+	return ReadCorpusStatistics(reader);
+}
+
+std::vector<Document> LocalSocketShard::FindTopDocuments(std::string_view raw_query, DocumentStatus status, const CorpusStatistics& corpus_statistics)
+{
+	MessageWriter writer;
+	writer.Write(ShardCommand::FIND_TOP_DOCUMENTS).WriteString(raw_query).Write(status);
+	WriteCorpusStatistics(writer, corpus_statistics);
+
+	const std::string response = Exchange(writer.GetData());
+	MessageReader reader(response);
+	reader.Read<ShardReply>();
+
+	std::vector<Document> documents(reader.ReadCount(2 * sizeof(int32_t) + sizeof(double)));
+	for (Document& document : documents)
+	{
+		document.id = reader.Read<int32_t>();
+		document.relevance = reader.Read<double>();
+		document.rating = reader.Read<int32_t>();
+	}
+	return documents;
+}
+
+std::vector<std::unique_ptr<ShardTransport>> MakeLocalSocketShards(const std::string& stop_words_text, size_t shard_count)
+{
+	std::vector<std::unique_ptr<ShardTransport>> shards;
+	for (size_t i = 0; i < shard_count; ++i)
+	{
+		shards.push_back(std::make_unique<LocalSocketShard>(stop_words_text));
+	}
+	return shards;
+}
+
+#endif
@@ -0,0 +1,87 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "document.h"
+#include "corpus_statistics.h"
+#include "search_server.h"
+
+//one shard of a ShardedSearchServer, either in this process or behind a socket
+class ShardTransport {
+public:
+	virtual ~ShardTransport() = default;
+
+	virtual void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) = 0;
+
+	virtual void RemoveDocument(int document_id) = 0;
+
+	virtual int GetDocumentCount() = 0;
+
+	virtual CorpusStatistics GetCorpusStatistics(std::string_view raw_query) = 0;
+
+	virtual std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status, const CorpusStatistics& corpus_statistics) = 0;
+};
+
+class InProcessShard : public ShardTransport {
+public:
+	explicit InProcessShard(const std::string& stop_words_text);
+
+	void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) override;
+
+	void RemoveDocument(int document_id) override;
+
+	int GetDocumentCount() override;
+
+	CorpusStatistics GetCorpusStatistics(std::string_view raw_query) override;
+
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status, const CorpusStatistics& corpus_statistics) override;
+
+private:
+	SearchServer search_server_;
+};
+
+#ifdef __unix__
+//serves requests read from socket_fd until the peer closes it or sends a corrupt frame; never throws,
+//so it is usable from a thread or a forked child process
+void RunShardServer(int socket_fd, SearchServer& search_server);
+
+//client side of a shard served by RunShardServer over a local stream socket
+class LocalSocketShard : public ShardTransport {
+public:
+	//spawns a server thread owning its own SearchServer, connected through a socketpair;
+	//throws what the SearchServer constructor throws
+	explicit LocalSocketShard(const std::string& stop_words_text);
+
+	//talks to an already running server, takes ownership of socket_fd
+	explicit LocalSocketShard(int socket_fd);
+
+	~LocalSocketShard() override;
+
+	void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) override;
+
+	void RemoveDocument(int document_id) override;
+
+	int GetDocumentCount() override;
+
+	CorpusStatistics GetCorpusStatistics(std::string_view raw_query) override;
+
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status, const CorpusStatistics& corpus_statistics) override;
+
+private:
+	int socket_fd_ = -1;
+	std::thread server_thread_;
+	std::mutex exchange_mutex_;
+
+	std::string Exchange(const std::string& request);
+};
+#endif
+
+std::vector<std::unique_ptr<ShardTransport>> MakeInProcessShards(const std::string& stop_words_text, size_t shard_count);
+
+#ifdef __unix__
+std::vector<std::unique_ptr<ShardTransport>> MakeLocalSocketShards(const std::string& stop_words_text, size_t shard_count);
+#endif
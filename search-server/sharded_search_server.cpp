@@ -0,0 +1,81 @@
+#include "sharded_search_server.h"
+#include "search_server.h"
+
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <stdexcept>
+
+ShardedSearchServer::ShardedSearchServer(std::vector<std::unique_ptr<ShardTransport>> shards)
+	: shards_(std::move(shards))
+{
+	using namespace std::literals;
+	if (shards_.empty())
+	{
+		throw std::invalid_argument("Sharded server needs at least one shard"s);
+	}
+}
+
+ShardTransport& ShardedSearchServer::GetShard(int document_id) const
+{
+	//splitmix64 finalizer, std::hash<int> is the identity on common implementations
+	uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(document_id)) + 0x9e3779b97f4a7c15ull;
+	hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+	hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+	hash ^= hash >> 31;
+	return *shards_[hash % shards_.size()];
+}
+
+void ShardedSearchServer::AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings)
+{
+	GetShard(document_id).AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id)
+{
+	GetShard(document_id).RemoveDocument(document_id);
+}
+
+int ShardedSearchServer::GetDocumentCount() const
+{
+	return std::transform_reduce(std::execution::par, shards_.begin(), shards_.end(), 0, std::plus<>(), [](const auto& shard)
+		{ return shard->GetDocumentCount(); });
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const
+{
+	std::vector<CorpusStatistics> shard_statistics(shards_.size());
+	std::transform(std::execution::par, shards_.begin(), shards_.end(), shard_statistics.begin(), [raw_query](const auto& shard)
+		{ return shard->GetCorpusStatistics(raw_query); });
+
+	CorpusStatistics corpus_statistics;
+	for (const CorpusStatistics& statistics : shard_statistics)
+	{
+		corpus_statistics.Merge(statistics);
+	}
+
+	std::vector<std::vector<Document>> shard_documents(shards_.size());
+	std::transform(std::execution::par, shards_.begin(), shards_.end(), shard_documents.begin(), [&](const auto& shard)
+		{ return shard->FindTopDocuments(raw_query, status, corpus_statistics); });
+
+	std::vector<Document> matched_documents;
+	for (const std::vector<Document>& documents : shard_documents)
+	{
+		matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+	}
+
+	const size_t result_size = std::min(matched_documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+	std::partial_sort(matched_documents.begin(), matched_documents.begin() + result_size, matched_documents.end(), SearchServer::IsMoreRelevant);
+	matched_documents.resize(result_size);
+	return matched_documents;
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view raw_query) const
+{
+	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+size_t ShardedSearchServer::GetShardCount() const
+{
+	return shards_.size();
+}
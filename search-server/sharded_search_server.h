@@ -0,0 +1,30 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "shard_transport.h"
+
+//partitions documents by id hash; IDF is computed over all shards, so results match a single SearchServer
+class ShardedSearchServer {
+public:
+	explicit ShardedSearchServer(std::vector<std::unique_ptr<ShardTransport>> shards);
+
+	void AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+	void RemoveDocument(int document_id);
+
+	int GetDocumentCount() const;
+
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const;
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;
+
+	size_t GetShardCount() const;
+
+private:
+	std::vector<std::unique_ptr<ShardTransport>> shards_;
+
+	ShardTransport& GetShard(int document_id) const;
+};
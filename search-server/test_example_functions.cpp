@@ -1,103 +1,1020 @@
-//#include "test_example_functions.h"
-//#include <cassert>
-//
-//void AddDocument(SearchServer& search_server, int document_id, const std::string& raw_query, DocumentStatus status, const std::vector<int>& ratings) 
-//{
-//	using namespace std;
-//	std::cout << "Добавление нового документа: "s << raw_query << std::endl;
-//
-//	{
-//		LOG_DURATION_STREAM("AddDocument"s, cout);
-//		search_server.AddDocument(document_id, raw_query, status, ratings);
-//	}
-//}
-//
-//void MatchDocuments(SearchServer& search_server, const std::string& query) 
-//{
-//	using namespace std;
-//	std::cout << "Матчинг документов по запросу: "s << query << std::endl;
-//
-//	{
-//		LOG_DURATION_STREAM("MatchDocument"s, cout);
-//		for (int document_id = 1; document_id < search_server.GetDocumentCount(); ++document_id) 
-//		{
-//			std::tuple<std::vector<std::string_view>, DocumentStatus> matched_docs = search_server.MatchDocument(query, document_id);
-//			std::cout << "{ document_id = "s << document_id << ", "s << matched_docs << " }"s << std::endl;
-//		}
-//	}
-//}
-//
-//void FindTopDocuments(SearchServer& search_server, const std::string& query) 
-//{
-//	using namespace std;
-//	std::cout << "Результаты поиска по запросу: "s << query << std::endl;
-//	std::vector<Document> found_docs;
-//	found_docs.reserve(static_cast<size_t>(search_server.GetDocumentCount()));
-//
-//	{
-//		LOG_DURATION_STREAM("FindTopDocuments"s, cout);
-//		found_docs = search_server.FindTopDocuments(query);
-//	}
-//
-//	for (Document& doc : found_docs) 
-//	{
-//		std::cout << doc << std::endl;
-//	}
-//}
-//
-//std::ostream& operator<<(std::ostream& output, std::tuple<std::vector<std::string_view>, DocumentStatus>& document)
-//{
-//	using namespace std;
-//	switch (std::get<1>(document)) 
-//	{
-//	case DocumentStatus::ACTUAL:
-//		output << " status = 0, "s;
-//		break;
-//	case DocumentStatus::IRRELEVANT:
-//		output << " status = 1, "s;
-//		break;
-//	case DocumentStatus::BANNED:
-//		output << " status = 2, "s;
-//		break;
-//	case DocumentStatus::REMOVED:
-//		output << " status = 3, "s;
-//		break;
-//	}
-//
-//	output << "word"s;
-//	for (const std::string_view& word : std::get<0>(document)) 
-//	{
-//		output << " "s << word.data();
-//	}
-//	return output;
-//}
-//
-//void TestFindTopDocuments() {
-//    SearchServer search_server("and with"s);
-//    int id = 0;
-//    for (
-//        const string& text : {
-//            "white cat and yellow hat"s,
-//            "curly cat curly tail"s,
-//            "nasty dog with big eyes"s,
-//            "nasty pigeon john"s
-//        }
-//        ) {
-//        search_server.AddDocument(++id, text, DocumentStatus::ACTUAL, { 1, 2 });
-//    }
-//    cout << "ACTUAL by default:"s << endl;
-//    // последовательная версия
-//    for (const Document& document : search_server.FindTopDocuments("curly nasty cat"s)) {
-//        PrintDocument(document);
-//    }
-//    cout << "BANNED:"s << endl;
-//    // последовательная версия
-//    for (const Document& document : search_server.FindTopDocuments(execution::seq, "curly nasty cat"s, DocumentStatus::BANNED)) {
-//        PrintDocument(document);
-//    }
-//    cout << "Even ids:"s << endl;
-//    // параллельная версия
-//    for (const Document& document : search_server.FindTopDocuments(execution::par, "curly nasty cat"s, [](int document_id, DocumentStatus status, int rating) { return document_id % 2 == 0; })) {
-//        PrintDocument(document);
-//    }
-//}
\ No newline at end of file
+#include "test_example_functions.h"
+#include "sharded_search_server.h"
+#include "query_log.h"
+#include "benchmark.h"
+#include "request_tracker.h"
+#include "replicated_search_server.h"
+#include "remove_duplicates.h"
+#include "corpus_loader.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __unix__
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+void AddDocument(SearchServer& search_server, int document_id, const std::string& raw_query, DocumentStatus status, const std::vector<int>& ratings) 
+{
+	using namespace std;
+	std::cout << "Добавление нового документа: "s << raw_query << std::endl;
+
+	{
+		LOG_DURATION_STREAM("AddDocument"s, cout);
+		search_server.AddDocument(document_id, raw_query, status, ratings);
+	}
+}
+
+void MatchDocuments(SearchServer& search_server, const std::string& query) 
+{
+	using namespace std;
+	std::cout << "Матчинг документов по запросу: "s << query << std::endl;
+
+	{
+		LOG_DURATION_STREAM("MatchDocument"s, cout);
+		for (int document_id = 1; document_id < search_server.GetDocumentCount(); ++document_id) 
+		{
+			std::tuple<std::vector<std::string_view>, DocumentStatus> matched_docs = search_server.MatchDocument(query, document_id);
+			std::cout << "{ document_id = "s << document_id << ", "s << matched_docs << " }"s << std::endl;
+		}
+	}
+}
+
+void FindTopDocuments(SearchServer& search_server, const std::string& query) 
+{
+	using namespace std;
+	std::cout << "Результаты поиска по запросу: "s << query << std::endl;
+	std::vector<Document> found_docs;
+	found_docs.reserve(static_cast<size_t>(search_server.GetDocumentCount()));
+
+	{
+		LOG_DURATION_STREAM("FindTopDocuments"s, cout);
+		found_docs = search_server.FindTopDocuments(query);
+	}
+
+	for (Document& doc : found_docs) 
+	{
+		std::cout << doc << std::endl;
+	}
+}
+
+std::ostream& operator<<(std::ostream& output, std::tuple<std::vector<std::string_view>, DocumentStatus>& document)
+{
+	using namespace std;
+	switch (std::get<1>(document)) 
+	{
+	case DocumentStatus::ACTUAL:
+		output << " status = 0, "s;
+		break;
+	case DocumentStatus::IRRELEVANT:
+		output << " status = 1, "s;
+		break;
+	case DocumentStatus::BANNED:
+		output << " status = 2, "s;
+		break;
+	case DocumentStatus::REMOVED:
+		output << " status = 3, "s;
+		break;
+	}
+
+	output << "word"s;
+	for (const std::string_view& word : std::get<0>(document)) 
+	{
+		output << " "s << word;
+	}
+	return output;
+}
+
+using namespace std::literals;
+
+template <typename Exception, typename Function>
+static void AssertThrows(Function function)
+{
+	bool thrown = false;
+	try
+	{
+		function();
+	}
+	catch (const Exception&)
+	{
+		thrown = true;
+	}
+	assert(thrown);
+}
+
+static std::vector<int> GetIds(const std::vector<Document>& documents)
+{
+	std::vector<int> ids;
+	for (const Document& document : documents)
+	{
+		ids.push_back(document.id);
+	}
+	return ids;
+}
+
+static void AddAnimalDocuments(SearchServer& search_server)
+{
+	int id = 0;
+	for (const std::string& text : { "white cat and yellow hat"s, "curly cat curly tail"s, "nasty dog with big eyes"s, "nasty pigeon john"s })
+	{
+		search_server.AddDocument(++id, text, DocumentStatus::ACTUAL, { 1, 2 });
+	}
+}
+
+static void TestFindTopDocuments()
+{
+	SearchServer search_server("and with"s);
+	AddAnimalDocuments(search_server);
+	search_server.AddDocument(5, "curly nasty cat"s, DocumentStatus::BANNED, { 4 });
+
+	assert((GetIds(search_server.FindTopDocuments("curly nasty cat"s)) == std::vector<int>{ 2, 4, 1, 3 }));
+	assert((GetIds(search_server.FindTopDocuments(std::execution::seq, "curly nasty cat"s, DocumentStatus::BANNED)) == std::vector<int>{ 5 }));
+	const auto even_ids = [](int document_id, [[maybe_unused]] DocumentStatus status, [[maybe_unused]] int rating) { return document_id % 2 == 0; };
+	assert((GetIds(search_server.FindTopDocuments(std::execution::par, "curly nasty cat"s, even_ids)) == std::vector<int>{ 2, 4 }));
+	assert(GetIds(search_server.FindTopDocuments("curly nasty cat -tail"s)) == GetIds(search_server.FindTopDocuments(std::execution::par, "curly nasty cat -tail"s)));
+	assert(search_server.FindTopDocuments("cat -cat"s).empty());
+	AssertThrows<std::invalid_argument>([&] { search_server.FindTopDocuments("cat --dog"s); });
+}
+
+static void TestTermTopDocuments()
+{
+	//lengths step by one word, so relevances of neighbours differ by less than EPSILON while the whole range does not;
+	//documents of the same length tie exactly and are ranked by rating, then id
+	SearchServer search_server("and"s);
+	for (int id = 0; id < 24; ++id)
+	{
+		std::string text = id % 3 == 2 ? "dog"s : "cat"s;
+		if (id % 5 == 0)
+		{
+			text += " bird"s;
+		}
+		for (int i = 0; i < 1000 + id % 8; ++i)
+		{
+			text += " x"s;
+		}
+		search_server.AddDocument(id, text, id % 4 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, { id % 3 });
+	}
+
+	//a minus prefix that matches nothing sends the same query down the general path
+	const auto assert_same_top = [&search_server](const std::string& query, const auto& predicate, const auto& scorer)
+		{
+			const std::vector<Document> merged = search_server.FindTopDocuments(std::execution::seq, query, predicate, scorer);
+			const std::vector<Document> general = search_server.FindTopDocuments(std::execution::seq, query + " -absent*"s, predicate, scorer);
+			assert(merged.size() == static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+			assert(GetIds(merged) == GetIds(general));
+			for (size_t i = 0; i < general.size(); ++i)
+			{
+				assert(merged[i].relevance == general[i].relevance);
+			}
+		};
+	const auto odd_ids = [](int document_id, [[maybe_unused]] DocumentStatus status, [[maybe_unused]] int rating) { return document_id % 2 == 1; };
+	const Bm25Scorer near_tie_bm25{ 1.2, 0.001 };
+	for (const std::string& query : { "cat"s, "cat bird"s, "x -bird"s, "x cat x -dog"s })
+	{
+		assert_same_top(query, DocumentStatusIs{ DocumentStatus::ACTUAL }, TfIdfScorer{});
+		assert_same_top(query, DocumentStatusIs{ DocumentStatus::ACTUAL }, near_tie_bm25);
+		assert_same_top(query, odd_ids, TfIdfScorer{});
+		assert_same_top(query, odd_ids, near_tie_bm25);
+		assert_same_top(query, AcceptAllDocuments{}, TfIdfScorer{});
+		assert_same_top(query, AcceptAllDocuments{}, near_tie_bm25);
+	}
+
+	//relevances far apart, so the chunked parallel merge has to agree with both sequential paths
+	SearchServer spread_server("and"s);
+	for (int id = 0; id < 100; ++id)
+	{
+		std::string text = id % 3 == 0 ? "cat"s : "dog"s;
+		for (int i = 0; i < id * 10; ++i)
+		{
+			text += id % 7 == 0 ? " bird"s : " x"s;
+		}
+		spread_server.AddDocument(id, text, DocumentStatus::ACTUAL, { id });
+	}
+	for (const std::string& query : { "cat"s, "cat dog"s, "dog cat dog -bird"s, "missing"s, "cat -cat"s })
+	{
+		const std::vector<Document> expected = spread_server.FindTopDocuments(std::execution::seq, query + " -absent*"s);
+		assert(GetIds(spread_server.FindTopDocuments(std::execution::seq, query)) == GetIds(expected));
+		assert(GetIds(spread_server.FindTopDocuments(std::execution::par, query)) == GetIds(expected));
+	}
+	assert((GetIds(spread_server.FindTopDocuments(std::execution::par, "cat -bird"s)) == std::vector<int>{ 0, 3, 6, 9, 12 }));
+}
+
+static void TestPhraseQueries()
+{
+	SearchServer search_server("and"s);
+	search_server.EnablePositionalIndex();
+	search_server.AddDocument(1, "white cat and yellow hat"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(2, "yellow cat white hat"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(3, "cat yellow"s, DocumentStatus::ACTUAL, { 1 });
+
+	assert((GetIds(search_server.FindTopDocuments("\"white cat\""s)) == std::vector<int>{ 1 }));
+	//stop words take no position, so "cat and yellow" contains the phrase "cat yellow"
+	assert((GetIds(search_server.FindTopDocuments("\"cat yellow\""s)) == std::vector<int>{ 1, 3 }));
+	assert((GetIds(search_server.FindTopDocuments(std::execution::par, "\"white cat\" hat"s)) == std::vector<int>{ 1 }));
+	//a lone quote opens or closes a phrase just like one attached to a word
+	assert((GetIds(search_server.FindTopDocuments("\" white cat \""s)) == std::vector<int>{ 1 }));
+	assert((GetIds(search_server.FindTopDocuments("\"white cat \" -hat"s)).empty()));
+	//an empty phrase is dropped and the query matches like its plain words
+	assert(GetIds(search_server.FindTopDocuments("\"\" cat"s)) == GetIds(search_server.FindTopDocuments("cat"s)));
+
+	AssertThrows<std::invalid_argument>([&] { search_server.FindTopDocuments("\"white cat"s); });
+	AssertThrows<std::invalid_argument>([&] { search_server.FindTopDocuments("cat \""s); });
+	AssertThrows<std::invalid_argument>([&] { search_server.FindTopDocuments("\"white -cat\""s); });
+	AssertThrows<std::invalid_argument>([&] { search_server.FindTopDocuments("\"white ca*\""s); });
+
+	SearchServer plain_server("and"s);
+	AddAnimalDocuments(plain_server);
+	AssertThrows<std::invalid_argument>([&] { plain_server.FindTopDocuments("\"white cat\""s); });
+}
+
+static void TestRemoveDocuments()
+{
+	SearchServer search_server("and with"s);
+	AddAnimalDocuments(search_server);
+	search_server.AddDocument(5, "curly dog"s, DocumentStatus::ACTUAL, { 3 });
+
+	search_server.RemoveDocuments({ 2, 4, 42 });
+	assert(search_server.GetDocumentCount() == 3);
+	assert((std::vector<int>(search_server.begin(), search_server.end()) == std::vector<int>{ 1, 3, 5 }));
+	assert((GetIds(search_server.FindTopDocuments("curly nasty"s)) == std::vector<int>{ 5, 3 }));
+	assert(search_server.GetWordFrequencies(2).empty());
+	AssertThrows<std::out_of_range>([&] { search_server.MatchDocument("cat"s, 2); });
+
+	search_server.RemoveDocuments(std::execution::par, { 1, 5 });
+	search_server.RemoveDocument(std::execution::par, 3);
+	assert(search_server.GetDocumentCount() == 0);
+	assert(search_server.FindTopDocuments("curly nasty cat"s).empty());
+	assert(search_server.GetStats().posting_count == 0);
+}
+
+static void TestDocumentCompaction()
+{
+	SearchServer search_server("and"s);
+	search_server.EnablePositionalIndex();
+	for (const int id : { 7, 3, 9, 1, 5, 8 })
+	{
+		search_server.AddDocument(id, "doc"s + std::to_string(id) + " white cat"s, DocumentStatus::ACTUAL, { id });
+	}
+	//ids come in ascending order whatever order the documents were added in
+	assert((std::vector<int>(search_server.begin(), search_server.end()) == std::vector<int>{ 1, 3, 5, 7, 8, 9 }));
+
+	search_server.RemoveDocument(7);
+	search_server.RemoveDocuments({ 1, 9 });
+	assert(search_server.GetStats().dead_storage_bytes > 0);
+	//a removed id may be added again while its old slot is a tombstone
+	search_server.AddDocument(7, "black cat"s, DocumentStatus::ACTUAL, { 2 });
+	//4 of 7 slots are tombstones now, so the slots are compacted
+	search_server.RemoveDocument(3);
+
+	const IndexStats stats = search_server.GetStats();
+	assert(stats.document_count == 3 && stats.dead_storage_bytes == 0);
+	assert((std::vector<int>(search_server.begin(), search_server.end()) == std::vector<int>{ 5, 7, 8 }));
+	assert((GetIds(search_server.FindTopDocuments("\"white cat\""s)) == std::vector<int>{ 8, 5 }));
+	assert((GetIds(search_server.FindTopDocuments("doc8 black"s)) == std::vector<int>{ 7, 8 }));
+	assert((GetIds(search_server.FindTopDocuments("cat -doc5"s)) == std::vector<int>{ 8, 7 }));
+	assert(std::get<0>(search_server.MatchDocument("doc5 dog"s, 5)) == std::vector<std::string_view>{ "doc5"sv });
+	assert((*search_server.GetWordFrequencies(8).begin()).first == "cat"sv);
+
+	search_server.AddDocument(10, "white dog"s, DocumentStatus::ACTUAL, { 1 });
+	assert((GetIds(search_server.FindTopDocuments("\"white dog\""s)) == std::vector<int>{ 10 }));
+	search_server.RemoveDocuments({ 5, 7, 8, 10 });
+	assert(search_server.GetDocumentCount() == 0 && search_server.GetStats().posting_count == 0);
+
+	//only live documents count as content
+	SearchServer emptied_server("and"s);
+	emptied_server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, { 1 });
+	emptied_server.AddDocument(2, "white dog"s, DocumentStatus::ACTUAL, { 1 });
+	emptied_server.RemoveDocument(1);
+	AssertThrows<std::logic_error>([&] { emptied_server.EnablePositionalIndex(); });
+	emptied_server.RemoveDocument(2);
+	emptied_server.EnablePositionalIndex();
+	emptied_server.AddDocument(3, "white cat"s, DocumentStatus::ACTUAL, { 1 });
+	assert((GetIds(emptied_server.FindTopDocuments("\"white cat\""s)) == std::vector<int>{ 3 }));
+}
+
+static void TestPreparedDocuments()
+{
+	const auto text = std::make_shared<const std::string>("white cat yellow hat\nwhite cat yellow hat"s);
+	const std::string_view first_text = std::string_view(*text).substr(0, 20);
+	const std::string_view second_text = std::string_view(*text).substr(21);
+
+	//prepared without a sketch, so the server sketches the documents itself
+	SearchServer preparing_server("and"s);
+	SearchServer search_server("and"s);
+	search_server.EnableNearDuplicateDetection({ 16, 4, 0.8, true });
+	search_server.AddPreparedDocument(preparing_server.PrepareDocument(1, first_text, DocumentStatus::ACTUAL, { 1 }), text);
+	AssertThrows<std::invalid_argument>([&] { search_server.AddPreparedDocument(preparing_server.PrepareDocument(2, second_text, DocumentStatus::ACTUAL, { 1 }), text); });
+	assert(search_server.GetDocumentCount() == 1);
+
+	//mapped text is not copied but still counts as storage
+	assert(search_server.GetStats().storage_bytes == first_text.size());
+	assert((GetIds(search_server.FindTopDocuments("cat"s)) == std::vector<int>{ 1 }));
+}
+
+static void TestCorpusLoader()
+{
+	const std::string path = (std::filesystem::temp_directory_path() / "search_server_test_corpus.tsv"s).string();
+	const auto write_corpus = [&path](const std::string& contents)
+		{
+			std::ofstream corpus_file(path, std::ios::binary);
+			corpus_file << contents;
+		};
+
+	//\r\n line ends, an empty ratings field and a missing final line end; a negative id, a duplicate id
+	//and a control character are rejected without stopping the load
+	const std::string lines = "1\t0\t1 2\twhite cat\r\n2\t0\t\tcurly dog\r\n-5\t0\t1\tnasty dog\r\n1\t0\t1\tcurly cat\r\n"s
+		"4\t0\t1\tbad\x01word\r\n3\t2\t5\tnasty cat"s;
+	write_corpus(lines);
+	SearchServer search_server("and"s);
+	CorpusLoadResult result = LoadCorpus(search_server, path, { CorpusFormat::LINES, 2 });
+	assert(result.document_count == 3 && result.rejected_count == 3 && result.byte_count == lines.size());
+	assert((GetIds(search_server.FindTopDocuments("dog"s)) == std::vector<int>{ 2 }));
+	assert((GetIds(search_server.FindTopDocuments("cat"s, DocumentStatus::BANNED)) == std::vector<int>{ 3 }));
+	assert(search_server.FindTopDocuments("white"s)[0].rating == 1);
+
+	//length-prefixed text is not scanned for delimiters, with or without a line end after it
+	for (const std::string& records : { "1\t0\t1\t9\nwhite cat\n2\t0\t\t9\ncurly dog\n"s, "1\t0\t1\t9\nwhite cat2\t0\t\t9\ncurly dog"s })
+	{
+		write_corpus(records);
+		SearchServer prefixed_server("and"s);
+		result = LoadCorpus(prefixed_server, path, { CorpusFormat::LENGTH_PREFIXED });
+		assert(result.document_count == 2 && result.rejected_count == 0);
+		assert((GetIds(prefixed_server.FindTopDocuments("cat dog"s)).size() == 2));
+	}
+
+	for (const std::string& malformed : { "1\t0\t1\t20\nwhite cat\n"s, "1\t0\t1\n"s, "1\t0\t1\t9x\nwhite cat\n"s })
+	{
+		write_corpus(malformed);
+		SearchServer malformed_server("and"s);
+		AssertThrows<std::invalid_argument>([&] { LoadCorpus(malformed_server, path, { CorpusFormat::LENGTH_PREFIXED }); });
+	}
+	write_corpus("1\t7\t1\twhite cat\n"s);
+	SearchServer status_server("and"s);
+	AssertThrows<std::invalid_argument>([&] { LoadCorpus(status_server, path); });
+
+	//the server keeps the mapping alive after the file is gone, and compaction moves the texts it still needs
+	std::string corpus;
+	for (int id = 1; id <= 6; ++id)
+	{
+		corpus += std::to_string(id) + "\t0\t1\tdoc"s + std::to_string(id) + " white cat\n"s;
+	}
+	write_corpus(corpus);
+	SearchServer mapped_server("and"s);
+	result = LoadCorpus(mapped_server, path);
+	std::filesystem::remove(path);
+	assert(result.document_count == 6);
+	mapped_server.RemoveDocuments({ 1, 2, 3, 4 });
+	assert(mapped_server.GetStats().dead_storage_bytes == 0);
+	assert((GetIds(mapped_server.FindTopDocuments("white doc6"s)) == std::vector<int>{ 6, 5 }));
+	const std::string query = "doc5 cat"s;
+	std::vector<std::string_view> words = std::get<0>(mapped_server.MatchDocument(query, 5));
+	std::sort(words.begin(), words.end());
+	assert((words == std::vector<std::string_view>{ "cat"sv, "doc5"sv }));
+}
+
+static void TestRemoveDuplicates()
+{
+	const auto remove_duplicates = [](const auto& policy)
+		{
+			SearchServer search_server("and with"s);
+			//duplicates repeat the word set of a lower id in another order, with repetitions or stop words
+			search_server.AddDocument(9, "cat white hat"s, DocumentStatus::ACTUAL, { 1 });
+			search_server.AddDocument(2, "white cat and hat"s, DocumentStatus::ACTUAL, { 1 });
+			search_server.AddDocument(5, "hat hat cat white white"s, DocumentStatus::BANNED, { 7 });
+			search_server.AddDocument(4, "curly dog"s, DocumentStatus::ACTUAL, { 1 });
+			search_server.AddDocument(7, "dog with curly dog"s, DocumentStatus::ACTUAL, { 1 });
+			search_server.AddDocument(3, "white cat"s, DocumentStatus::ACTUAL, { 1 });
+			search_server.AddDocument(6, "curly dog tail"s, DocumentStatus::ACTUAL, { 1 });
+
+			assert((RemoveDuplicates(policy, search_server) == std::vector<int>{ 5, 7, 9 }));
+			assert((std::vector<int>(search_server.begin(), search_server.end()) == std::vector<int>{ 2, 3, 4, 6 }));
+			assert(RemoveDuplicates(policy, search_server).empty());
+		};
+	remove_duplicates(std::execution::seq);
+	remove_duplicates(std::execution::par);
+}
+
+static void TestNearDuplicates()
+{
+	SearchServer search_server("and with"s);
+	search_server.AddDocument(1, "white cat yellow hat collar"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.EnableNearDuplicateDetection({ 16, 4, 0.8, true });
+	AssertThrows<std::invalid_argument>([&] { search_server.AddDocument(2, "yellow hat and white cat collar"s, DocumentStatus::ACTUAL, { 1 }); });
+	search_server.AddDocument(3, "curly dog tail"s, DocumentStatus::ACTUAL, { 1 });
+
+	//documents without words share no words, so they are not duplicates of each other
+	search_server.AddDocument(4, ""s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(5, "and with"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(6, "  "s, DocumentStatus::ACTUAL, { 1 });
+	assert(search_server.GetDocumentCount() == 5);
+	assert(search_server.FindNearDuplicates(4).empty());
+	search_server.RemoveDocument(5);
+
+	search_server.RemoveDocument(1);
+	search_server.AddDocument(2, "yellow hat and white cat collar"s, DocumentStatus::ACTUAL, { 1 });
+	assert(search_server.FindNearDuplicates(2).empty());
+}
+
+static void TestIndexStats()
+{
+	SearchServer search_server("and"s);
+	AddAnimalDocuments(search_server);
+
+	IndexStats stats = search_server.GetStats();
+	assert(stats.document_count == 4 && stats.term_count == 13 && stats.dictionary_term_count == 13);
+	assert(stats.posting_count == 15);
+	//"cat" and "nasty" occur in two documents, every other term in one
+	assert(stats.posting_length_histogram[0] == 11 && stats.posting_length_histogram[1] == 2);
+	assert(stats.storage_bytes >= 4 * sizeof(std::string) + "white cat and yellow hat curly cat curly tail nasty dog with big eyes nasty pigeon john"s.size() - 3);
+	assert(stats.dead_storage_bytes == 0);
+	assert(stats.TotalBytes() > stats.storage_bytes);
+
+	search_server.RemoveDocument(4);
+	stats = search_server.GetStats();
+	assert(stats.document_count == 3 && stats.term_count == 11 && stats.dictionary_term_count == 11);
+	assert(stats.posting_count == 12);
+	assert(stats.posting_length_histogram[0] == 10 && stats.posting_length_histogram[1] == 1);
+	assert(stats.dead_storage_bytes > 0);
+
+	std::ostringstream output;
+	output << stats;
+	assert(output.str().find("estimated_allocations = "s) != std::string::npos);
+}
+
+static void TestBm25Scoring()
+{
+	SearchServer search_server("and"s);
+	search_server.AddDocument(1, "cat cat dog"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(2, "dog bird"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(3, "bird fish fish fish"s, DocumentStatus::ACTUAL, { 1 });
+
+	const Bm25Scorer scorer;
+	const std::vector<Document> found = search_server.FindTopDocuments(std::execution::seq, "cat"s, DocumentStatusIs{ DocumentStatus::ACTUAL }, scorer);
+	assert(found.size() == 1 && found[0].id == 1);
+	//N = 3, df = 1, tf = 2, document length 3, average length 3
+	const double term_weight = std::log(1.0 + (3 - 1 + 0.5) / (1 + 0.5));
+	const double expected = term_weight * 2 * (scorer.k1 + 1.0) / (2 + scorer.k1);
+	assert(std::abs(found[0].relevance - expected) < EPSILON);
+}
+
+static void TestWordFrequencies()
+{
+	SearchServer search_server("and"s);
+	search_server.AddDocument(1, "white cat and fluffy white tail"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(2, "zebra and ant"s, DocumentStatus::ACTUAL, { 1 });
+
+	std::vector<std::pair<std::string_view, double>> frequencies;
+	for (const auto& entry : search_server.GetWordFrequencies(1))
+	{
+		frequencies.push_back(entry);
+	}
+	assert(frequencies.size() == 4);
+	assert(frequencies[0].first == "cat"sv && frequencies[1].first == "fluffy"sv);
+	assert(frequencies[2].first == "tail"sv && frequencies[3].first == "white"sv);
+	assert(std::abs(frequencies[3].second - 0.4) < EPSILON);
+	assert((*search_server.GetWordFrequencies(2).begin()).first == "ant"sv);
+
+	//terms without postings leave the dictionary
+	assert(search_server.GetStats().dictionary_term_count == 6);
+	search_server.RemoveDocument(1);
+	assert(search_server.GetStats().dictionary_term_count == 2);
+	search_server.AddDocument(3, "cat"s, DocumentStatus::ACTUAL, { 1 });
+	const IndexStats stats = search_server.GetStats();
+	assert(stats.dictionary_term_count == 3 && stats.term_count == 3);
+}
+
+static void TestPrefixQueries()
+{
+	SearchServer search_server("and"s);
+	search_server.AddDocument(1, "cat catalog"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(2, "category dog"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(3, "dog"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(4, "cart"s, DocumentStatus::ACTUAL, { 1 });
+
+	std::vector<int> ids = GetIds(search_server.FindTopDocuments("cat*"s));
+	std::sort(ids.begin(), ids.end());
+	assert((ids == std::vector<int>{ 1, 2 }));
+	assert((GetIds(search_server.FindTopDocuments(std::execution::par, "dog -cat*"s)) == std::vector<int>{ 3 }));
+	assert(search_server.FindTopDocuments("zebra*"s).empty());
+	const auto [matched_words, status] = search_server.MatchDocument("cat* dog"s, 1);
+	assert((matched_words == std::vector<std::string_view>{ "cat"sv, "catalog"sv }));
+	assert(std::get<0>(search_server.MatchDocument("dog -cat*"s, 2)).empty());
+}
+
+static void TestPrefixExpansionCap()
+{
+	//more expansions than the cap: the frequent late term has to survive it, in one index and across shards
+	SearchServer single_server("and"s);
+	ShardedSearchServer sharded_server(MakeInProcessShards("and"s, 3));
+	for (int id = 0; id < static_cast<int>(MAX_PREFIX_EXPANSION_COUNT) + 50; ++id)
+	{
+		const std::string text = "pre"s + std::to_string(1000 + id) + " filler"s;
+		single_server.AddDocument(id, text, DocumentStatus::ACTUAL, { 0 });
+		sharded_server.AddDocument(id, text, DocumentStatus::ACTUAL, { 0 });
+	}
+	for (int id = 1000; id < 1005; ++id)
+	{
+		single_server.AddDocument(id, "prezzz filler"s, DocumentStatus::ACTUAL, { 10 });
+		sharded_server.AddDocument(id, "prezzz filler"s, DocumentStatus::ACTUAL, { 10 });
+	}
+
+	const std::vector<Document> expected = single_server.FindTopDocuments("pre*"s);
+	assert((GetIds(expected) == std::vector<int>{ 1000, 1001, 1002, 1003, 1004 }));
+	const std::vector<Document> found = sharded_server.FindTopDocuments("pre*"s);
+	assert(GetIds(found) == GetIds(expected));
+	for (size_t i = 0; i < found.size(); ++i)
+	{
+		assert(std::abs(found[i].relevance - expected[i].relevance) < EPSILON);
+	}
+
+	//minus prefixes are exact whatever the range size
+	assert(single_server.FindTopDocuments("filler -pre*"s).empty());
+	assert(std::get<0>(single_server.MatchDocument("filler -pre1*"s, 3)).empty());
+	assert(!std::get<0>(single_server.MatchDocument("filler -pre1*"s, 1000)).empty());
+}
+
+static void TestFuzzyMatching()
+{
+	SearchServer search_server("and"s);
+	search_server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(2, "yellow parrot"s, DocumentStatus::ACTUAL, { 1 });
+	assert(search_server.FindTopDocuments("parot"s).empty());
+
+	search_server.EnableFuzzyMatching();
+	assert((GetIds(search_server.FindTopDocuments("parot"s)) == std::vector<int>{ 2 }));
+	assert((GetIds(search_server.FindTopDocuments(std::execution::par, "whtie"s)) == std::vector<int>{ 1 }));
+	assert(search_server.FindTopDocuments("elephant"s).empty());
+
+	//terms of removed documents leave the dictionary, and their ids go to new terms
+	search_server.RemoveDocument(2);
+	assert(search_server.FindTopDocuments("parot"s).empty());
+	search_server.AddDocument(3, "green parrots"s, DocumentStatus::ACTUAL, { 1 });
+	assert((GetIds(search_server.FindTopDocuments("parot"s)) == std::vector<int>{ 3 }));
+	assert(search_server.FindTopDocuments("yelow"s).empty());
+
+	//shards correct against the merged statistics: "parot" is missing only on the second shard and stays as it is,
+	//"grean" is corrected only to the term that is most frequent over both shards
+	SearchServer single_server("and"s);
+	std::vector<SearchServer> shards;
+	shards.emplace_back("and"s);
+	shards.emplace_back("and"s);
+	const std::vector<std::pair<int, std::string>> texts = {
+		{ 1, "parot green"s }, { 2, "groan tree"s }, { 3, "green tree"s }, { 4, "green parrot"s }, { 5, "groan cat"s }, { 6, "groan dog"s }, { 7, "groan"s }
+	};
+	for (const auto& [id, text] : texts)
+	{
+		single_server.AddDocument(id, text, DocumentStatus::ACTUAL, { id });
+		shards[id < 3 ? 0 : 1].AddDocument(id, text, DocumentStatus::ACTUAL, { id });
+	}
+	const FuzzyMatchingOptions single_correction{ 2, 7, 1 };
+	single_server.EnableFuzzyMatching(single_correction);
+	for (SearchServer& shard : shards)
+	{
+		shard.EnableFuzzyMatching(single_correction);
+	}
+	for (const std::string& query : { "parot"s, "grean"s, "grean tre"s })
+	{
+		CorpusStatistics corpus_statistics;
+		for (const SearchServer& shard : shards)
+		{
+			corpus_statistics.Merge(shard.GetCorpusStatistics(query));
+		}
+		std::vector<Document> found;
+		for (const SearchServer& shard : shards)
+		{
+			const std::vector<Document> documents = shard.FindTopDocuments(std::execution::seq, query, DocumentStatusIs{ DocumentStatus::ACTUAL }, corpus_statistics);
+			found.insert(found.end(), documents.begin(), documents.end());
+		}
+		std::sort(found.begin(), found.end(), SearchServer::IsMoreRelevant);
+		found.resize(std::min(found.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT)));
+		const std::vector<Document> expected = single_server.FindTopDocuments(query);
+		assert(GetIds(found) == GetIds(expected));
+		for (size_t i = 0; i < found.size(); ++i)
+		{
+			assert(std::abs(found[i].relevance - expected[i].relevance) < EPSILON);
+		}
+	}
+	assert((GetIds(single_server.FindTopDocuments("parot"s)) == std::vector<int>{ 1 }));
+	std::vector<int> groan_ids = GetIds(single_server.FindTopDocuments("grean"s));
+	std::sort(groan_ids.begin(), groan_ids.end());
+	assert((groan_ids == std::vector<int>{ 2, 5, 6, 7 }));
+
+	//a misspelled phrase word is replaced by its best correction, and the positions must still line up
+	SearchServer phrase_server("and"s);
+	phrase_server.EnablePositionalIndex();
+	phrase_server.AddDocument(1, "yellow parrot sings"s, DocumentStatus::ACTUAL, { 1 });
+	phrase_server.AddDocument(2, "parrot yellow"s, DocumentStatus::ACTUAL, { 1 });
+	phrase_server.EnableFuzzyMatching();
+	assert((GetIds(phrase_server.FindTopDocuments("\"yelow parot\""s)) == std::vector<int>{ 1 }));
+	assert((GetIds(phrase_server.FindTopDocuments(std::execution::par, "\"parrot yelow\""s)) == std::vector<int>{ 2 }));
+	assert(phrase_server.FindTopDocuments("\"qqqqqqqq parrot\""s).empty());
+
+	//no verified candidate, no correction
+	SearchServer capped_server("and"s);
+	capped_server.AddDocument(1, "yellow parrot"s, DocumentStatus::ACTUAL, { 1 });
+	capped_server.EnableFuzzyMatching(FuzzyMatchingOptions{ 2, 7, 4, 0 });
+	assert(capped_server.FindTopDocuments("parot"s).empty());
+
+	assert(FuzzyIndex::ComputeEditDistance("cat"sv, "act"sv, 2) == 1);
+	assert(FuzzyIndex::ComputeEditDistance("kitten"sv, "sitting"sv, 2) == 3);
+	AssertThrows<std::invalid_argument>([] { FuzzyIndex(FuzzyMatchingOptions{ 3, 7, 4 }); });
+}
+
+static void TestShardingMatchesSingleIndex()
+{
+	const std::vector<std::string> texts = {
+		"white cat and yellow hat"s, "curly cat curly tail"s, "nasty dog with big eyes"s, "nasty pigeon john"s,
+		"big cat big dog"s, "yellow pigeon and white dog"s, "tail of the nasty cat"s, "john and his curly dog"s
+	};
+	SearchServer single_server("and with"s);
+	ShardedSearchServer sharded_server(MakeInProcessShards("and with"s, 3));
+	for (int id = 0; id < static_cast<int>(texts.size()); ++id)
+	{
+		const DocumentStatus status = id % 3 == 2 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+		single_server.AddDocument(id, texts[id], status, { id });
+		sharded_server.AddDocument(id, texts[id], status, { id });
+	}
+	single_server.RemoveDocument(4);
+	sharded_server.RemoveDocument(4);
+	assert(sharded_server.GetDocumentCount() == single_server.GetDocumentCount());
+
+	for (const std::string& query : { "cat"s, "curly nasty cat"s, "dog -big"s, "pigeon john yellow"s, "tail -curly"s, "c* -ta*"s, "nas* pig*"s })
+	{
+		for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED })
+		{
+			const std::vector<Document> expected = single_server.FindTopDocuments(query, status);
+			const std::vector<Document> found = sharded_server.FindTopDocuments(query, status);
+			assert(GetIds(found) == GetIds(expected));
+			for (size_t i = 0; i < found.size(); ++i)
+			{
+				assert(std::abs(found[i].relevance - expected[i].relevance) < EPSILON);
+			}
+		}
+	}
+}
+
+#ifdef __unix__
+static void TestLocalSocketShards()
+{
+	//the server thread reports a failed start instead of terminating the process
+	AssertThrows<std::invalid_argument>([] { LocalSocketShard("and w\x01th"s); });
+
+	ShardedSearchServer sharded_server(MakeLocalSocketShards("and"s, 2));
+	sharded_server.AddDocument(1, "white cat and collar"s, DocumentStatus::ACTUAL, { 1 });
+	sharded_server.AddDocument(2, "fluffy cat tail"s, DocumentStatus::ACTUAL, { 2 });
+	assert(sharded_server.GetDocumentCount() == 2);
+	assert(sharded_server.FindTopDocuments("cat"s).size() == 2);
+
+	//an oversized frame header is answered with an error and ends the session
+	int socket_fds[2];
+	assert(socketpair(AF_UNIX, SOCK_STREAM, 0, socket_fds) == 0);
+	SearchServer search_server("and"s);
+	std::thread server_thread([&] { RunShardServer(socket_fds[1], search_server); });
+	const uint64_t huge_size = uint64_t{ 1 } << 40;
+	assert(write(socket_fds[0], &huge_size, sizeof(huge_size)) == static_cast<ssize_t>(sizeof(huge_size)));
+	server_thread.join();
+	close(socket_fds[1]);
+	LocalSocketShard shard(socket_fds[0]);
+	AssertThrows<std::runtime_error>([&] { shard.GetDocumentCount(); });
+
+	//a status outside DocumentStatus is refused like an invalid argument and the session goes on
+	assert(socketpair(AF_UNIX, SOCK_STREAM, 0, socket_fds) == 0);
+	std::thread checked_server_thread([&] { RunShardServer(socket_fds[1], search_server); });
+	std::string request(1, '\0');
+	const int32_t document_id = 1;
+	const uint64_t text_size = 3;
+	const int32_t status = 9;
+	const uint64_t rating_count = 0;
+	request.append(reinterpret_cast<const char*>(&document_id), sizeof(document_id));
+	request.append(reinterpret_cast<const char*>(&text_size), sizeof(text_size)).append("cat"s);
+	request.append(reinterpret_cast<const char*>(&status), sizeof(status));
+	request.append(reinterpret_cast<const char*>(&rating_count), sizeof(rating_count));
+	const uint64_t request_size = request.size();
+	assert(write(socket_fds[0], &request_size, sizeof(request_size)) == static_cast<ssize_t>(sizeof(request_size)));
+	assert(write(socket_fds[0], request.data(), request.size()) == static_cast<ssize_t>(request.size()));
+	uint64_t reply_size = 0;
+	assert(read(socket_fds[0], &reply_size, sizeof(reply_size)) == static_cast<ssize_t>(sizeof(reply_size)));
+	std::string reply(reply_size, '\0');
+	assert(read(socket_fds[0], reply.data(), reply.size()) == static_cast<ssize_t>(reply.size()));
+	//the reply code is INVALID_ARGUMENT
+	assert(reply[0] == 1);
+	{
+		LocalSocketShard checked_shard(socket_fds[0]);
+		assert(checked_shard.GetDocumentCount() == 0);
+	}
+	checked_server_thread.join();
+	close(socket_fds[1]);
+}
+#endif
+
+static void TestReplicatedSearchServer()
+{
+	SearchServer search_server("and"s);
+	AddAnimalDocuments(search_server);
+	const ReplicatedSearchServer replicated_server({ { 0, { 0, 0 } }, { 1, { 0 } } }, []
+		{
+			auto replica = std::make_unique<SearchServer>("and"s);
+			AddAnimalDocuments(*replica);
+			return replica;
+		});
+
+	const std::vector<std::string> queries = { "cat"s, "nasty -dog"s, "curly tail"s, "hat"s, "fish"s };
+	for (int round = 0; round < 2; ++round)
+	{
+		for (const size_t node_count : { 1, 2 })
+		{
+			const auto results = replicated_server.ProcessQueries(queries, node_count);
+			assert(results.size() == queries.size());
+			for (size_t i = 0; i < queries.size(); ++i)
+			{
+				assert(GetIds(results[i]) == GetIds(search_server.FindTopDocuments(queries[i])));
+			}
+		}
+	}
+
+	//a malformed query is rethrown to the caller and the workers keep serving
+	AssertThrows<std::invalid_argument>([&] { replicated_server.ProcessQueries({ "cat"s, "cat --dog"s, "hat"s }); });
+	AssertThrows<std::out_of_range>([&] { replicated_server.ProcessQueries(queries, 3); });
+	assert(GetIds(replicated_server.ProcessQueries(queries)[0]) == GetIds(search_server.FindTopDocuments("cat"s)));
+}
+
+static void TestFacets()
+{
+	SearchServer search_server("and"s);
+	search_server.AddDocument(1, "white cat and collar"s, DocumentStatus::ACTUAL, { 8, -3 });
+	search_server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+	search_server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::ACTUAL, { 5, -12, 2, 1 });
+	search_server.AddDocument(4, "groomed cat bird"s, DocumentStatus::BANNED, { 9 });
+	search_server.AddDocument(5, "cat dog"s, DocumentStatus::IRRELEVANT, { -9 });
+	search_server.AddDocument(6, "cat dog tail"s, DocumentStatus::ACTUAL, { -1 });
+
+	for (const SearchResult& result : {
+		search_server.FindTopDocumentsWithFacets(std::execution::seq, "cat dog -tail"s, DocumentStatus::ACTUAL, { -5, 0, 5 }),
+		search_server.FindTopDocumentsWithFacets(std::execution::par, "cat dog -tail"s, DocumentStatus::ACTUAL, { 5, 0, -5 }) })
+	{
+		assert(GetIds(result.documents) == GetIds(search_server.FindTopDocuments("cat dog -tail"s)));
+		assert((result.facets.status_counts == std::array<size_t, DOCUMENT_STATUS_COUNT>{ 2, 1, 1, 0 }));
+		assert((result.facets.rating_counts == std::vector<size_t>{ 1, 1, 1, 1 }));
+		assert(result.facets.GetMatchCount() == 4);
+	}
+
+	//facets count every match, the predicate only narrows the top documents
+	const SearchResult banned = search_server.FindTopDocumentsWithFacets(std::execution::seq, "groomed"s, DocumentStatus::BANNED, {});
+	assert((GetIds(banned.documents) == std::vector<int>{ 4 }));
+	assert((banned.facets.status_counts == std::array<size_t, DOCUMENT_STATUS_COUNT>{ 1, 0, 1, 0 }));
+	assert((banned.facets.rating_counts == std::vector<size_t>{ 2 }));
+
+	const SearchResult any_status = search_server.FindTopDocumentsWithFacets(std::execution::par, "groomed"s, {});
+	assert((GetIds(any_status.documents) == std::vector<int>{ 4, 3 }));
+	assert(any_status.facets.status_counts == banned.facets.status_counts);
+
+	//matches the predicate rejects still go through the minus filters before they are counted
+	for (const SearchResult& result : {
+		search_server.FindTopDocumentsWithFacets(std::execution::seq, "cat -gro*"s, DocumentStatus::BANNED, {}),
+		search_server.FindTopDocumentsWithFacets(std::execution::par, "cat -gro*"s, DocumentStatus::BANNED, {}) })
+	{
+		assert(result.documents.empty());
+		assert((result.facets.status_counts == std::array<size_t, DOCUMENT_STATUS_COUNT>{ 3, 1, 0, 0 }));
+	}
+	//a document under several plus terms, words or prefixes, is counted once
+	for (const SearchResult& result : {
+		search_server.FindTopDocumentsWithFacets(std::execution::seq, "dog gro* cat"s, DocumentStatus::ACTUAL, { 0 }),
+		search_server.FindTopDocumentsWithFacets(std::execution::par, "dog gro* cat"s, DocumentStatus::ACTUAL, { 0 }) })
+	{
+		assert((result.facets.status_counts == std::array<size_t, DOCUMENT_STATUS_COUNT>{ 4, 1, 1, 0 }));
+		assert((result.facets.rating_counts == std::vector<size_t>{ 3, 3 }));
+	}
+
+	SearchFacets default_facets;
+	default_facets.Add(DocumentStatus::REMOVED, 5);
+	assert((default_facets.rating_counts == std::vector<size_t>{ 1 }) && default_facets.GetMatchCount() == 1);
+	AssertThrows<std::invalid_argument>([&] { default_facets.Merge(SearchFacets({ 0 })); });
+}
+
+static void TestConcurrentMap()
+{
+	//a few shards, so that probe runs are long and backward shift deletion has entries to move
+	ConcurrentMap<std::string, int> concurrent_map(3);
+	std::map<std::string, int> expected;
+	std::mt19937 generator(42);
+	for (int operation = 0; operation < 20000; ++operation)
+	{
+		const std::string key = "key"s + std::to_string(std::uniform_int_distribution(0, 499)(generator));
+		if (std::uniform_int_distribution(0, 2)(generator) == 0)
+		{
+			assert(concurrent_map.erase(key) == expected.erase(key));
+		}
+		else
+		{
+			const int value = std::uniform_int_distribution(-100, 100)(generator);
+			concurrent_map[key].ref_to_value += value;
+			expected[key] += value;
+		}
+		if (operation % 1000 == 0)
+		{
+			assert(concurrent_map.size() == expected.size());
+		}
+	}
+	assert(concurrent_map.size() == expected.size());
+	assert(concurrent_map.BuildOrdinaryMap() == expected);
+
+	//writers insert and erase their own keys and all add to the shared ones
+	const int thread_count = 4;
+	const int shared_key_count = 50;
+	const int operation_count = 5000;
+	ConcurrentMap<std::string, int> shared_map(8);
+	std::vector<std::map<std::string, int>> thread_expected(thread_count);
+	std::vector<std::thread> writers;
+	for (int thread = 0; thread < thread_count; ++thread)
+	{
+		writers.emplace_back([&, thread]
+			{
+				std::mt19937 thread_generator(thread);
+				std::map<std::string, int>& own_expected = thread_expected[thread];
+				for (int operation = 0; operation < operation_count; ++operation)
+				{
+					shared_map["shared"s + std::to_string(operation % shared_key_count)].ref_to_value += 1;
+					const std::string key = std::to_string(thread) + "_"s + std::to_string(std::uniform_int_distribution(0, 199)(thread_generator));
+					if (std::uniform_int_distribution(0, 2)(thread_generator) == 0)
+					{
+						assert(shared_map.erase(key) == own_expected.erase(key));
+					}
+					else
+					{
+						shared_map[key].ref_to_value += operation;
+						own_expected[key] += operation;
+					}
+				}
+			});
+	}
+	for (std::thread& writer : writers)
+	{
+		writer.join();
+	}
+
+	std::map<std::string, int> merged_expected;
+	for (int key = 0; key < shared_key_count; ++key)
+	{
+		merged_expected["shared"s + std::to_string(key)] = thread_count * operation_count / shared_key_count;
+	}
+	for (const std::map<std::string, int>& own_expected : thread_expected)
+	{
+		merged_expected.insert(own_expected.begin(), own_expected.end());
+	}
+	assert(shared_map.size() == merged_expected.size());
+	assert(shared_map.BuildOrdinaryMap() == merged_expected);
+}
+
+static void TestQueryLog()
+{
+	SearchServer search_server("and"s);
+	search_server.AddDocument(1, "white cat and collar"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(2, "fluffy cat tail"s, DocumentStatus::ACTUAL, { 2 });
+	AssertThrows<std::logic_error>([&] { search_server.GetHotTerms(1); });
+
+	search_server.EnableQueryLog();
+	search_server.FindTopDocuments("cat tail"s);
+	search_server.FindTopDocuments(std::execution::par, "cat -white missing"s);
+	search_server.FindTopDocuments("collar cat"s);
+	const std::vector<HotTerm> hot_terms = search_server.GetHotTerms(2);
+	assert(hot_terms.size() == 2);
+	assert(hot_terms[0].term == "cat"s && hot_terms[0].count == 3);
+	assert(hot_terms[1].count == 1);
+
+	//counts of exited threads are kept
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 4; ++i)
+	{
+		threads.emplace_back([&search_server] { search_server.FindTopDocuments("fluffy"s); });
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	const std::vector<HotTerm> merged_terms = search_server.GetHotTerms(2);
+	assert(merged_terms[0].term == "fluffy"s && merged_terms[0].count == 4 && merged_terms[1].term == "cat"s);
+
+	std::stringstream log;
+	WriteQueryLog(log, hot_terms);
+	const std::vector<HotTerm> read_terms = ReadQueryLog(log);
+	assert(read_terms.size() == hot_terms.size());
+	for (size_t i = 0; i < read_terms.size(); ++i)
+	{
+		assert(read_terms[i].term == hot_terms[i].term && read_terms[i].count == hot_terms[i].count);
+	}
+	const WarmupResult warmup = search_server.WarmUp(read_terms).get();
+	assert(warmup.term_count == 2 && warmup.posting_count == 3);
+
+	std::istringstream blank_lines("\ncat 3\n\n"s);
+	assert(ReadQueryLog(blank_lines).size() == 1);
+	for (const std::string& malformed : { "cat\n"s, "cat 3 x\n"s, "cat three\n"s })
+	{
+		std::istringstream input(malformed);
+		AssertThrows<std::invalid_argument>([&] { ReadQueryLog(input); });
+	}
+}
+
+static void TestInstrumentation()
+{
+	ResetMetrics();
+	//samples of exited threads are kept after their slots are handed back
+	for (int round = 0; round < 2; ++round)
+	{
+		std::vector<std::thread> threads;
+		for (int i = 0; i < 3; ++i)
+		{
+			threads.emplace_back([] { RecordStageLatency(Stage::MATCH, 100); AddMetricsCounter(Counter::DOCUMENTS_SCORED, 2); });
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+	const MetricsSnapshot snapshot = TakeMetricsSnapshot();
+	assert(snapshot.stages[static_cast<size_t>(Stage::MATCH)].total_count == 6);
+	assert(snapshot.counters[static_cast<size_t>(Counter::DOCUMENTS_SCORED)] == 12);
+
+	ResetMetrics();
+	assert(TakeMetricsSnapshot().stages[static_cast<size_t>(Stage::MATCH)].total_count == 0);
+}
+
+static void TestRequestTracker()
+{
+	using namespace std::chrono;
+	RequestTracker tracker(4);
+	const RequestTracker::Clock::time_point now = RequestTracker::Clock::now() + seconds(100);
+
+	//with a ring of 4 most records are folded into the per-minute aggregates
+	for (int i = 0; i < 8; ++i)
+	{
+		tracker.Record(now - hours(2) + milliseconds(i), microseconds(10), 1);
+	}
+	for (int i = 0; i < 8; ++i)
+	{
+		tracker.Record(now - minutes(10) + milliseconds(i), microseconds(20), i % 2);
+	}
+	std::thread([&tracker, now] { tracker.Record(now - minutes(5), microseconds(30), 0); }).join();
+
+	const RequestStats recent = tracker.GetStats(hours(1), now);
+	assert(recent.request_count == 9 && recent.no_result_count == 5);
+	assert(recent.latency.total_count == 9 && recent.latency.max_value == 30000);
+	assert(tracker.GetStats(hours(3), now).request_count == 17);
+
+	//the tracker is only about 100 seconds old, so the rate is not diluted by the hour
+	assert(recent.queries_per_second > 9.0 / 101 && recent.queries_per_second < 9.0 / 99);
+}
+
+static void TestBenchmarkConfig()
+{
+	const BenchmarkConfig config = ParseBenchmarkConfig({ "--documents"s, "100"s, "--queries"s, "7"s });
+	assert(config.document_count == 100 && config.query_count == 7);
+	AssertThrows<std::invalid_argument>([] { ParseBenchmarkConfig({ "--documents"s, "100"s, "--queries"s }); });
+	AssertThrows<std::invalid_argument>([] { ParseBenchmarkConfig({ "--unknown"s, "1"s }); });
+	//values are whole numbers, counts are not negative
+	assert(ParseBenchmarkConfig({ "--zipf"s, "1.5"s }).zipf_exponent == 1.5);
+	for (const std::string& value : { "abc"s, "12x"s, "-5"s, ""s })
+	{
+		AssertThrows<std::invalid_argument>([&value] { ParseBenchmarkConfig({ "--documents"s, value }); });
+	}
+	AssertThrows<std::invalid_argument>([] { ParseBenchmarkConfig({ "--zipf"s, "1.5.2"s }); });
+}
+
+void TestSearchServer()
+{
+	TestFindTopDocuments();
+	TestTermTopDocuments();
+	TestPhraseQueries();
+	TestRemoveDocuments();
+	TestDocumentCompaction();
+	TestPreparedDocuments();
+	TestCorpusLoader();
+	TestWordFrequencies();
+	TestNearDuplicates();
+	TestIndexStats();
+	TestRemoveDuplicates();
+	TestBm25Scoring();
+	TestPrefixQueries();
+	TestPrefixExpansionCap();
+	TestFuzzyMatching();
+	TestShardingMatchesSingleIndex();
+#ifdef __unix__
+	TestLocalSocketShards();
+#endif
+	TestReplicatedSearchServer();
+	TestFacets();
+	TestConcurrentMap();
+	TestQueryLog();
+	TestInstrumentation();
+	TestBenchmarkConfig();
+	TestRequestTracker();
+	std::cout << "Search server tests passed"s << std::endl;
+}
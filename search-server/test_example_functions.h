@@ -1,14 +1,19 @@
-//#pragma once
-//#include <string>
-//#include "process_queries.h"
-//#include "search_server.h"
-//#include "log_duration.h"
-//#include "document.h"
-//
-//void AddDocument(SearchServer&, int, const std::string&, DocumentStatus, const std::vector<int>&);
-//
-//void MatchDocuments(SearchServer&, const std::string&);
-//
-//void FindTopDocuments(SearchServer&, const std::string&);
-//
-//std::ostream& operator<<(std::ostream&, std::tuple<std::vector<std::string_view>, DocumentStatus>&);
\ No newline at end of file
+#pragma once
+#include <string>
+#include <tuple>
+#include <vector>
+#include "process_queries.h"
+#include "search_server.h"
+#include "log_duration.h"
+#include "document.h"
+
+void AddDocument(SearchServer&, int, const std::string&, DocumentStatus, const std::vector<int>&);
+
+void MatchDocuments(SearchServer&, const std::string&);
+
+void FindTopDocuments(SearchServer&, const std::string&);
+
+std::ostream& operator<<(std::ostream&, std::tuple<std::vector<std::string_view>, DocumentStatus>&);
+
+//runs every unit test, aborting on the first failed assertion
+void TestSearchServer();
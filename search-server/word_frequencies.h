@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct TermFrequency {
+	uint32_t term_id;
+	uint32_t count;
+};
+
+//lightweight view of a document forward index: terms are stored as ids and resolved through the server dictionary
+class WordFrequencies {
+public:
+	class Iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = std::pair<std::string_view, double>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = value_type;
+
+		Iterator(std::vector<TermFrequency>::const_iterator it, const std::vector<std::string_view>* terms, double inv_document_length)
+			: it_(it), terms_(terms), inv_document_length_(inv_document_length)
+		{
+		}
+
+		value_type operator*() const
+		{
+			return { (*terms_)[it_->term_id], it_->count * inv_document_length_ };
+		}
+
+		Iterator& operator++()
+		{
+			++it_;
+			return *this;
+		}
+
+		Iterator operator++(int)
+		{
+			Iterator old = *this;
+			++it_;
+			return old;
+		}
+
+		bool operator==(const Iterator& other) const
+		{
+			return it_ == other.it_;
+		}
+
+		bool operator!=(const Iterator& other) const
+		{
+			return it_ != other.it_;
+		}
+
+	private:
+		std::vector<TermFrequency>::const_iterator it_;
+		const std::vector<std::string_view>* terms_;
+		double inv_document_length_;
+	};
+
+	WordFrequencies() = default;
+
+	//entries hold raw term counts, frequencies are computed on the fly from the document length
+	WordFrequencies(const std::vector<TermFrequency>& entries, const std::vector<std::string_view>& terms, uint32_t document_length)
+		: entries_(&entries), terms_(&terms), inv_document_length_(1.0 / document_length)
+	{
+	}
+
+	Iterator begin() const
+	{
+		return { entries_ ? entries_->begin() : Empty().begin(), terms_, inv_document_length_ };
+	}
+
+	Iterator end() const
+	{
+		return { entries_ ? entries_->end() : Empty().end(), terms_, inv_document_length_ };
+	}
+
+	size_t size() const
+	{
+		return entries_ ? entries_->size() : 0;
+	}
+
+	bool empty() const
+	{
+		return size() == 0;
+	}
+
+private:
+	const std::vector<TermFrequency>* entries_ = nullptr;
+	const std::vector<std::string_view>* terms_ = nullptr;
+	double inv_document_length_ = 0.0;
+
+	static const std::vector<TermFrequency>& Empty()
+	{
+		static const std::vector<TermFrequency> empty;
+		return empty;
+	}
+};